@@ -0,0 +1,153 @@
+// Request-scoped JSON work (parse a body, read fields, build and dump the
+// response envelope) with nlohmann::json on the global heap vs. RequestJson
+// in the request arena. Besides the time, each case reports how many global
+// operator new calls one request makes once the worker is warm.
+#include "bench_util.h"
+#include "request_arena.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    size_t heap_allocations = 0;    // the benchmark is single-threaded
+
+    const char* TASK_BODY = R"({"title":"Write the quarterly report","description":"Numbers for Q3 and the hiring plan"})";
+
+    std::string batch_body(int count) {
+        nlohmann::json tasks = nlohmann::json::array();
+        for (int i = 0; i < count; ++i) {
+            tasks.push_back({{"title", "Task " + std::to_string(i) + " to finish"}, {"completed", i % 3 == 0}});
+        }
+        return nlohmann::json{{"tasks", tasks}}.dump();
+    }
+
+    // Mirror APIRoutes::create_success_response / create_error_response for either DOM
+    template <typename Json>
+    Json success(const std::string& message, Json data = Json::object()) {
+        Json response;
+        response["success"] = true;
+        response["message"] = message;
+        if (!data.empty()) {
+            response["data"] = std::move(data);
+        }
+        return response;
+    }
+
+    template <typename Json>
+    Json error(const std::string& message, int code) {
+        Json response;
+        response["success"] = false;
+        Json& error = response["error"];
+        error["message"] = message;
+        error["code"] = code;
+        return response;
+    }
+
+    std::string dump(const nlohmann::json& value) { return value.dump(); }
+    std::string dump(const RequestJson& value) { return dump_json(value); }
+
+    // Field reads and the response envelope of POST /api/tasks
+    template <typename Json>
+    std::string create_task(const std::string& body) {
+        auto json_data = Json::parse(body);
+        const auto& title = json_data["title"].template get_ref<const std::string&>();
+        std::string description = json_data.value("description", "");
+        bench::do_not_optimize(title);
+        bench::do_not_optimize(description);
+        return dump(success<Json>("Task created successfully"));
+    }
+
+    // POST /api/tasks/batch: every item read, a result per item in the response
+    template <typename Json>
+    std::string create_batch(const std::string& body) {
+        auto json_data = Json::parse(body);
+        const auto& elements = json_data["tasks"];
+        Json items = Json::array();
+        for (size_t i = 0; i < elements.size(); ++i) {
+            const auto& title = elements[i]["title"].template get_ref<const std::string&>();
+            bench::do_not_optimize(title);
+            Json& item = items.emplace_back();
+            item["index"] = i;
+            item["status"] = 201;
+            item["id"] = 1000 + i;
+        }
+        Json data;
+        data["results"] = std::move(items);
+        data["succeeded"] = elements.size();
+        data["failed"] = 0;
+        return dump(success<Json>("Tasks created", std::move(data)));
+    }
+
+    template <typename Json>
+    std::string bad_request(const std::string&) {
+        return dump(error<Json>("Missing required field: title", 400));
+    }
+
+    // The arena cases run inside a Scope, as handlers do under APIRoutes::observe
+    template <typename Fn>
+    void run_case(const std::string& name, Fn request, bool scoped) {
+        auto once = [&]() {
+            if (scoped) {
+                RequestArena::Scope scratch;
+                return request();
+            }
+            return request();
+        };
+
+        bench::run(name, [&] {
+            auto body = once();
+            bench::do_not_optimize(body);
+        });
+
+        const size_t samples = 1000;
+        size_t before = heap_allocations;
+        for (size_t i = 0; i < samples; ++i) {
+            auto body = once();
+            bench::do_not_optimize(body);
+        }
+        double per_request = static_cast<double>(heap_allocations - before) / samples;
+        bench::annotate("heap_allocations", per_request);
+        std::printf("  %.1f global heap allocations per request\n", per_request);
+    }
+}
+
+void* operator new(size_t size) {
+    ++heap_allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+    const std::string task = TASK_BODY;
+    const std::string batch = batch_body(100);
+
+    run_case("create task heap", [&] { return create_task<nlohmann::json>(task); }, false);
+    run_case("create task arena", [&] { return create_task<RequestJson>(task); }, true);
+    run_case("error response heap", [&] { return bad_request<nlohmann::json>(task); }, false);
+    run_case("error response arena", [&] { return bad_request<RequestJson>(task); }, true);
+    run_case("batch of 100 heap", [&] { return create_batch<nlohmann::json>(batch); }, false);
+    run_case("batch of 100 arena", [&] { return create_batch<RequestJson>(batch); }, true);
+
+    // A request far bigger than the arena may keep must not leave its blocks behind
+    {
+        RequestArena::Scope scratch;
+        auto body = create_batch<RequestJson>(batch_body(20000));
+        bench::do_not_optimize(body);
+    }
+    size_t retained = RequestArena::retained_bytes();
+    std::printf("\narena retained after a large request: %zu bytes\n", retained);
+    if (retained > RequestArena::MAX_RETAINED_BYTES) {
+        std::printf("arena kept more than MAX_RETAINED_BYTES (%zu)\n", RequestArena::MAX_RETAINED_BYTES);
+        return 1;
+    }
+
+    auto stats = RequestArena::stats();
+    std::printf("\narena blocks allocated: %llu (%llu bytes)\n",
+                static_cast<unsigned long long>(stats.blocks_allocated), static_cast<unsigned long long>(stats.bytes_allocated));
+    return bench::write_report(argc, argv, "arena") ? 0 : 1;
+}
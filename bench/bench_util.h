@@ -0,0 +1,96 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Minimal timing harness for the microbenchmarks: runs fn until min_time has
+// elapsed (after one warm-up call) and reports the mean cost per iteration.
+// Every result is also kept for write_report(), which saves them as JSON when
+// the benchmark is started with --json <path>.
+namespace bench {
+
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+    std::string name;
+    double ns_per_op;
+    size_t iterations;
+    std::map<std::string, double> counters;     // extra figures reported with the timing
+};
+
+inline std::vector<Result>& results() {
+    static std::vector<Result> all;
+    return all;
+}
+
+template <typename Fn>
+Result run(const std::string& name, Fn&& fn, std::chrono::milliseconds min_time = std::chrono::milliseconds(500)) {
+    using clock = std::chrono::steady_clock;
+    fn();
+
+    size_t iterations = 0;
+    size_t batch = 1;
+    auto start = clock::now();
+    auto elapsed = clock::duration::zero();
+    while (elapsed < min_time) {
+        for (size_t i = 0; i < batch; ++i) {
+            fn();
+        }
+        iterations += batch;
+        batch *= 2;
+        elapsed = clock::now() - start;
+    }
+
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::printf("%-48s %14.1f ns/op %12zu iterations\n", name.c_str(), ns, iterations);
+    results().push_back(Result{name, ns, iterations, {}});
+    return results().back();
+}
+
+// Attaches a figure such as an output size to the most recent result
+inline void annotate(const std::string& key, double value) {
+    if (!results().empty()) {
+        results().back().counters[key] = value;
+    }
+}
+
+// Returns false only if --json was given and the file could not be written
+inline bool write_report(int argc, char** argv, const char* suite) {
+    const char* path = nullptr;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            path = argv[i + 1];
+        }
+    }
+    if (!path) {
+        return true;
+    }
+
+    nlohmann::json report = {{"suite", suite}, {"results", nlohmann::json::array()}};
+    for (const Result& result : results()) {
+        nlohmann::json entry = {
+            {"name", result.name},
+            {"ns_per_op", result.ns_per_op},
+            {"ops_per_second", 1e9 / result.ns_per_op},
+            {"iterations", result.iterations}
+        };
+        for (const auto& [key, value] : result.counters) {
+            entry[key] = value;
+        }
+        report["results"].push_back(entry);
+    }
+
+    std::ofstream out(path);
+    out << report.dump(2) << '\n';
+    return static_cast<bool>(out);
+}
+
+}  // namespace bench
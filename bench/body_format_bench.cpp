@@ -0,0 +1,190 @@
+// JSON vs. MessagePack vs. CBOR task pages: payload size, the server's cost to
+// transcode a rendered page (streaming, and through a DOM for comparison), and
+// the client's cost to decode it. Before timing anything, every transcoded
+// document is checked to decode to the same value nlohmann parses from the JSON.
+#include "bench_util.h"
+#include "body_format.h"
+#include "database.h"
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+    const char* BENCH_DB = "body_format_bench.db";
+    const int TASK_COUNT = 2000;
+
+    void seed(Database& db) {
+        db.execute("DELETE FROM tasks; DELETE FROM users;");
+        db.create_user("bench", "bench@example.com", "hash");
+        int user_id = db.get_user_by_username("bench")["id"];
+        std::vector<TaskBatchItem> items(TASK_COUNT);
+        for (int i = 0; i < TASK_COUNT; ++i) {
+            items[i].title = "Task " + std::to_string(i) + " to finish";
+            items[i].description = "Follow up on ticket " + std::to_string(10000 + i * 13) + " before Friday";
+            items[i].completed = i % 3 == 0;
+        }
+        std::vector<TaskBatchResult> results(TASK_COUNT);
+        db.create_tasks(user_id, items, results);
+    }
+
+    // Random documents mixing every JSON type, nesting and number range
+    nlohmann::json random_value(std::mt19937_64& rng, int depth) {
+        switch (rng() % (depth > 0 ? 9 : 7)) {
+            case 0: return nullptr;
+            case 1: return rng() % 2 == 0;
+            case 2: return static_cast<int64_t>(rng()) >> (rng() % 64);
+            case 3: return static_cast<uint64_t>(rng()) >> (rng() % 64);
+            case 4: return std::ldexp(static_cast<double>(static_cast<int64_t>(rng())), static_cast<int>(rng() % 200) - 100);
+            case 5: {
+                static const std::vector<std::string> pieces = {"a", "Ω", "€", "😀", "\"", "\\", "\n", "\x01", " ", "é", "z"};
+                std::string text;
+                for (size_t n = rng() % 40; n > 0; --n) {
+                    text += pieces[rng() % pieces.size()];
+                }
+                return text;
+            }
+            case 6: return std::string(rng() % 300, 'x');
+            case 7: {
+                nlohmann::json array = nlohmann::json::array();
+                for (size_t n = rng() % 20; n > 0; --n) {
+                    array.push_back(random_value(rng, depth - 1));
+                }
+                return array;
+            }
+            default: {
+                nlohmann::json object = nlohmann::json::object();
+                for (size_t n = rng() % 20; n > 0; --n) {
+                    object["k" + std::to_string(rng() % 1000)] = random_value(rng, depth - 1);
+                }
+                return object;
+            }
+        }
+    }
+
+    // The streaming transcoder must agree with nlohmann on every document: the binary
+    // body decodes to the same value, and invalid JSON is refused with the body untouched
+    bool check_equivalence(const std::vector<std::string>& pages) {
+        std::vector<std::string> documents = {
+            "0", "-0", "-1", "1.5", "-0.0", "1e308", "-1e-308", "5e-324", "[]", "{}", "[[],{},[[{}]]]",
+            "{\"a\":{\"b\":{\"c\":[]}}}", "\"\"", "true", "false", "null",
+            "127", "128", "255", "256", "65535", "65536", "4294967295", "4294967296",
+            "-32", "-33", "-128", "-129", "-32768", "-32769", "-2147483648", "-2147483649",
+            "9223372036854775807", "9223372036854775808", "18446744073709551615", "18446744073709551616",
+            "-9223372036854775808", "-9223372036854775809", "123456789012345678901234567890",
+            "\"\\ud83d\\ude00 \\u00e9 \\u0000 \\n\\t\\\"\\/\"", "\"é€😀\"",
+            " { \"spaced\" : [ 1 , 2.25 , \"x\" ] } ", std::string(70000, ' ') + "\"" + std::string(70000, 'y') + "\""
+        };
+        documents.insert(documents.end(), pages.begin(), pages.end());
+        std::mt19937_64 rng(42);
+        for (int i = 0; i < 2000; ++i) {
+            documents.push_back(random_value(rng, 4).dump());
+        }
+
+        const std::vector<std::string> malformed = {
+            "", "{", "[1,]", "{\"a\":}", "01", "1.", "-", "nul", "\"unterminated", "\"\\ud800\"",
+            "\"\\udc00\"", "\"\xff\"", "\"\xc0\x80\"", "[1] 2", "{\"a\" 1}", "\"\\x\"", "[\"\t\"]"
+        };
+
+        size_t mismatches = 0;
+        for (BodyFormat::Format format : {BodyFormat::Format::MsgPack, BodyFormat::Format::Cbor}) {
+            const char* format_name = BodyFormat::name(format);
+            for (const auto& document : documents) {
+                auto expected = nlohmann::json::parse(document);
+                std::string body = document;
+                bool decoded_equal = false;
+                if (BodyFormat::transcode(format, body)) {
+                    try {
+                        auto decoded = format == BodyFormat::Format::MsgPack ? nlohmann::json::from_msgpack(body)
+                                                                             : nlohmann::json::from_cbor(body);
+                        decoded_equal = decoded == expected;
+                    } catch (const nlohmann::json::exception&) {
+                    }
+                }
+                if (!decoded_equal) {
+                    std::cerr << format_name << " mismatch: '" << document.substr(0, 200) << "'" << std::endl;
+                    ++mismatches;
+                }
+            }
+            for (const auto& document : malformed) {
+                std::string body = document;
+                if (BodyFormat::transcode(format, body) || body != document || nlohmann::json::accept(document)) {
+                    std::cerr << format_name << " accepted malformed: '" << document << "'" << std::endl;
+                    ++mismatches;
+                }
+            }
+        }
+        return mismatches == 0;
+    }
+
+    std::string render_page(Database& db, int limit) {
+        PageQuery query;
+        query.limit = limit;
+        std::optional<int> next_cursor;
+        std::string body = "{\"success\":true,\"message\":\"Tasks retrieved successfully\",\"data\":";
+        db.write_all_tasks(query, body, next_cursor);
+        body += ",\"pagination\":{\"limit\":" + std::to_string(limit) + ",\"next_cursor\":null}}";
+        return body;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::remove(BENCH_DB);
+    Database db(BENCH_DB, 1);
+    if (!db.initialize()) {
+        std::cerr << "Failed to initialize benchmark database" << std::endl;
+        return 1;
+    }
+    seed(db);
+
+    if (!check_equivalence({render_page(db, 50), render_page(db, 1000)})) {
+        std::cerr << "BodyFormat::transcode disagrees with nlohmann::json" << std::endl;
+        std::remove(BENCH_DB);
+        return 1;
+    }
+
+    using Format = BodyFormat::Format;
+    for (int limit : {50, 1000}) {
+        const std::string page = render_page(db, limit);
+        std::string page_name = "page limit=" + std::to_string(limit);
+
+        for (Format format : {Format::Json, Format::MsgPack, Format::Cbor}) {
+            std::string encoded = page;
+            BodyFormat::transcode(format, encoded);
+            std::string name = page_name + " " + BodyFormat::name(format);
+
+            // Server side: JSON is already rendered, so its cost is the copy every case pays
+            std::string body;
+            bench::run(name + " transcode", [&] {
+                body = page;
+                BodyFormat::transcode(format, body);
+                bench::do_not_optimize(body);
+            });
+            bench::annotate("bytes", static_cast<double>(encoded.size()));
+
+            if (format != Format::Json) {
+                bench::run(name + " dom transcode", [&] {
+                    auto document = nlohmann::json::parse(page);
+                    auto bytes = format == Format::MsgPack ? nlohmann::json::to_msgpack(document) : nlohmann::json::to_cbor(document);
+                    bench::do_not_optimize(bytes);
+                });
+            }
+
+            // Client side: decoding the payload into a DOM
+            auto decode = bench::run(name + " decode", [&] {
+                auto document = BodyFormat::parse(format, encoded);
+                bench::do_not_optimize(document);
+            });
+            double mb_per_second = encoded.size() / decode.ns_per_op * 1e9 / (1024 * 1024);
+            bench::annotate("bytes", static_cast<double>(encoded.size()));
+            bench::annotate("mb_per_second", mb_per_second);
+            std::printf("  %zu bytes (%.1f%% of JSON), decoded at %.0f MB/s\n", encoded.size(),
+                        100.0 * encoded.size() / page.size(), mb_per_second);
+        }
+        std::printf("\n");
+    }
+
+    std::remove(BENCH_DB);
+    return bench::write_report(argc, argv, "body_format") ? 0 : 1;
+}
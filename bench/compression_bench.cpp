@@ -0,0 +1,133 @@
+// CPU cost vs. bytes saved by ResponseCompressor for task list pages.
+#include "bench_util.h"
+#include "database.h"
+#include "response_compressor.h"
+#include <cstdio>
+#include <iostream>
+
+namespace {
+    const char* BENCH_DB = "compression_bench.db";
+    const int TASK_COUNT = 2000;
+
+    void seed(Database& db) {
+        db.execute("DELETE FROM tasks; DELETE FROM users;");
+        db.create_user("bench", "bench@example.com", "hash");
+        int user_id = db.get_user_by_username("bench")["id"];
+        const char* verbs[] = {"Review", "Write", "Fix", "Plan", "Call", "Ship", "Test"};
+        const char* nouns[] = {"budget", "release notes", "login bug", "offsite", "supplier", "v2 API", "backups"};
+        std::vector<TaskBatchItem> items(TASK_COUNT);
+        for (int i = 0; i < TASK_COUNT; ++i) {
+            items[i].title = std::string(verbs[i % 7]) + " " + nouns[(i / 7) % 7] + " #" + std::to_string(i);
+            items[i].description = "Follow up with " + std::to_string(i * 37 % 101) + " before the " +
+                                   nouns[(i / 3) % 7] + " deadline; notes in ticket " + std::to_string(10000 + i * 13);
+        }
+        std::vector<TaskBatchResult> results(TASK_COUNT);
+        db.create_tasks(user_id, items, results);
+    }
+
+    std::string render_page(Database& db, int limit) {
+        PageQuery query;
+        query.limit = limit;
+        std::optional<int> next_cursor;
+        std::string body = "{\"success\":true,\"message\":\"Tasks retrieved successfully\",\"data\":";
+        db.write_all_tasks(query, body, next_cursor);
+        body += ",\"pagination\":{\"limit\":" + std::to_string(limit) + ",\"next_cursor\":null}}";
+        return body;
+    }
+
+    void run_case(const std::string& page_name, const std::string& page, ResponseCompressor::Encoding encoding, int level) {
+        ResponseCompressor::Config config;
+        config.min_bytes = 0;
+        config.level = level;
+        config.zstd_level = level;
+        ResponseCompressor compressor(config);
+
+        std::string body;
+        size_t compressed_size = page.size();
+        std::string name = page_name + " " + ResponseCompressor::encoding_name(encoding);
+        if (encoding != ResponseCompressor::Encoding::Identity) {
+            name += " level=" + std::to_string(level);
+        }
+
+        // Copying the page is part of every case, identity included, so the difference is the compressor
+        auto result = bench::run(name, [&] {
+            body = page;
+            if (compressor.compress(encoding, body)) {
+                compressed_size = body.size();
+            }
+            bench::do_not_optimize(body);
+        });
+
+        double ratio = static_cast<double>(compressed_size) / page.size();
+        double mb_per_second = page.size() / result.ns_per_op * 1e9 / (1024 * 1024);
+        bench::annotate("bytes_in", static_cast<double>(page.size()));
+        bench::annotate("bytes_out", static_cast<double>(compressed_size));
+        bench::annotate("ratio", ratio);
+        bench::annotate("mb_per_second", mb_per_second);
+        std::printf("  %zu -> %zu bytes (%.1f%%), %.0f MB/s\n", page.size(), compressed_size, ratio * 100, mb_per_second);
+    }
+
+    // Compresses an export-sized body and checks the thread's output buffer does not keep its size
+    bool check_export_retention(const std::string& page, ResponseCompressor::Encoding encoding) {
+        ResponseCompressor::Config config;
+        config.min_bytes = 0;
+        ResponseCompressor compressor(config);
+
+        std::string body;
+        while (body.size() < Database::MAX_EXPORT_BYTES / 2) {
+            body += page;
+        }
+        size_t export_bytes = body.size();
+        bool compressed = compressor.compress(encoding, body);
+
+        size_t retained = ResponseCompressor::retained_bytes();
+        std::printf("export %s: %zu bytes %s, %zu bytes retained\n", ResponseCompressor::encoding_name(encoding),
+                    export_bytes, compressed ? "compressed" : "not compressed", retained);
+        if (retained > ResponseCompressor::MAX_RETAINED_BYTES) {
+            std::cerr << "Compressor kept " << retained << " bytes after an export, over "
+                      << ResponseCompressor::MAX_RETAINED_BYTES << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::remove(BENCH_DB);
+    Database db(BENCH_DB, 1);
+    if (!db.initialize()) {
+        std::cerr << "Failed to initialize benchmark database" << std::endl;
+        return 1;
+    }
+    seed(db);
+
+    using Encoding = ResponseCompressor::Encoding;
+    for (int limit : {50, 1000}) {
+        std::string page = render_page(db, limit);
+        std::string page_name = "page limit=" + std::to_string(limit);
+
+        run_case(page_name, page, Encoding::Identity, 0);
+        for (int level : {1, 6, 9}) {
+            run_case(page_name, page, Encoding::Gzip, level);
+        }
+        run_case(page_name, page, Encoding::Deflate, 6);
+        if (ResponseCompressor::zstd_available()) {
+            for (int level : {1, 3, 9}) {
+                run_case(page_name, page, Encoding::Zstd, level);
+            }
+        }
+        std::printf("\n");
+    }
+
+    std::string page = render_page(db, 1000);
+    bool retention_ok = check_export_retention(page, Encoding::Gzip);
+    if (ResponseCompressor::zstd_available()) {
+        retention_ok = check_export_retention(page, Encoding::Zstd) && retention_ok;
+    }
+
+    std::remove(BENCH_DB);
+    if (!retention_ok) {
+        return 1;
+    }
+    return bench::write_report(argc, argv, "compression") ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+// Per-call cost of the Database read/write paths, token verification, row
+// serialization and full-text search, measured against a seeded file database.
+#include "bench_util.h"
+#include "auth_service.h"
+#include "connection_pool.h"
+#include "database.h"
+#include "json_writer.h"
+#include "token_cache.h"
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+    const char* BENCH_DB = "database_bench.db";
+    const int USER_COUNT = 100;
+    const int TASKS_PER_USER = 100;
+    const int WRITER_THREADS = 8;
+    const int WRITES_PER_THREAD = 64;
+
+    void remove_database() {
+        for (const char* suffix : {"", "-wal", "-shm"}) {
+            std::remove((std::string(BENCH_DB) + suffix).c_str());
+        }
+    }
+
+    bool seed(Database& db) {
+        for (int user = 1; user <= USER_COUNT; ++user) {
+            std::string name = "user" + std::to_string(user);
+            if (!db.create_user(name, name + "@example.com", "hash")) {
+                return false;
+            }
+
+            std::vector<TaskBatchItem> items(TASKS_PER_USER);
+            for (int i = 0; i < TASKS_PER_USER; ++i) {
+                items[i].title = "Task " + std::to_string(i) + " for " + name;
+                items[i].description = "Some longer descriptive text for the task";
+            }
+            std::vector<TaskBatchResult> results(TASKS_PER_USER);
+            if (!db.create_tasks(user, items, results)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The old DOM conversion (row_to_json_task) as the baseline for JsonRowWriter
+    nlohmann::json row_to_json_task(sqlite3_stmt* stmt) {
+        nlohmann::json task;
+        task["id"] = sqlite3_column_int(stmt, 0);
+        task["title"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        task["description"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+        task["completed"] = sqlite3_column_int(stmt, 3) == 1;
+        task["user_id"] = sqlite3_column_int(stmt, 4);
+        task["created_at"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+        task["updated_at"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
+        return task;
+    }
+}
+
+int main(int argc, char** argv) {
+    remove_database();
+    Database db(BENCH_DB);
+    if (!db.initialize() || !seed(db)) {
+        std::cerr << "Failed to seed benchmark database" << std::endl;
+        return 1;
+    }
+    // Same file without row caches, for the uncached read paths
+    Database uncached(BENCH_DB, 0, 0);
+    if (!uncached.initialize()) {
+        return 1;
+    }
+
+    const int task_count = USER_COUNT * TASKS_PER_USER;
+    int next_id = 0;
+    std::string out;
+
+    std::printf("-- reads\n");
+    bench::run("write_task_by_id (row cache hit)", [&] {
+        out.clear();
+        db.write_task_by_id(next_id++ % 100 + 1, out);
+        bench::do_not_optimize(out);
+    });
+    bench::run("write_task_by_id (uncached)", [&] {
+        out.clear();
+        uncached.write_task_by_id(next_id++ % task_count + 1, out);
+        bench::do_not_optimize(out);
+    });
+    bench::run("get_user_by_username", [&] {
+        bench::do_not_optimize(db.get_user_by_username("user" + std::to_string(next_id++ % USER_COUNT + 1)));
+    });
+    PageQuery page;
+    bench::run("write_all_tasks limit=50", [&] {
+        out.clear();
+        std::optional<int> next_cursor;
+        page.after_id = next_id++ % (task_count - 50);
+        db.write_all_tasks(page, out, next_cursor);
+        bench::do_not_optimize(out);
+    });
+    PageQuery first_page;
+    bench::run("write_tasks_by_user limit=50", [&] {
+        out.clear();
+        std::optional<int> next_cursor;
+        db.write_tasks_by_user(next_id++ % USER_COUNT + 1, first_page, out, next_cursor);
+        bench::do_not_optimize(out);
+    });
+    SearchQuery search;
+    search.limit = 20;
+    bench::run("search_tasks selective (100 matches) limit=20", [&] {
+        out.clear();
+        std::optional<std::string> next_cursor;
+        search.text = "user" + std::to_string(next_id++ % USER_COUNT + 1);
+        db.search_tasks(search, out, next_cursor);
+        bench::do_not_optimize(out);
+    });
+    bench::run("search_tasks broad (every task) limit=20", [&] {
+        out.clear();
+        std::optional<std::string> next_cursor;
+        search.text = "task";
+        db.search_tasks(search, out, next_cursor);
+        bench::do_not_optimize(out);
+    });
+    bench::run("search_tasks prefix \"descr*\" limit=20", [&] {
+        out.clear();
+        std::optional<std::string> next_cursor;
+        search.text = "descr*";
+        db.search_tasks(search, out, next_cursor);
+        bench::do_not_optimize(out);
+    });
+    SearchQuery recent = search;
+    recent.order = SearchQuery::Order::Recent;
+    bench::run("search_tasks broad, sort=recent limit=20", [&] {
+        out.clear();
+        std::optional<std::string> next_cursor;
+        recent.text = "task";
+        db.search_tasks(recent, out, next_cursor);
+        bench::do_not_optimize(out);
+    });
+
+    std::printf("\n-- writes (group commit)\n");
+    bench::run("create_task (one writer)", [&] {
+        bench::do_not_optimize(db.create_task("bench", "single writer", 1));
+    });
+    TaskBatchItem changes;
+    changes.completed = true;
+    bench::run("update_task (ownership-scoped)", [&] {
+        out.clear();
+        int task_id = next_id++ % TASKS_PER_USER + 1;
+        bench::do_not_optimize(db.update_task(task_id, 1, changes, out));
+    });
+    auto concurrent = bench::run("create_task x" + std::to_string(WRITER_THREADS * WRITES_PER_THREAD) +
+                                 " (" + std::to_string(WRITER_THREADS) + " threads)", [&] {
+        std::vector<std::thread> writers;
+        for (int t = 0; t < WRITER_THREADS; ++t) {
+            writers.emplace_back([&db, t]() {
+                for (int i = 0; i < WRITES_PER_THREAD; ++i) {
+                    db.create_task("bench", "concurrent writer", t + 1);
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+    });
+    std::printf("  %.0f writes/s, largest batch %zu\n",
+                1e9 * WRITER_THREADS * WRITES_PER_THREAD / concurrent.ns_per_op, db.write_stats().largest_batch);
+
+    std::printf("\n-- auth\n");
+    std::string token = AuthService::generate_jwt_token(1, "user1");
+    bench::run("AuthService::verify_jwt_token", [&] {
+        bench::do_not_optimize(AuthService::verify_jwt_token(token));
+    });
+    TokenCache token_cache(1024, AuthService::token_lifetime_seconds());
+    bench::run("TokenCache::verify (hit)", [&] {
+        bench::do_not_optimize(token_cache.verify(token));
+    });
+
+    std::printf("\n-- serialization\n");
+    sqlite3* conn = ConnectionPool::open_connection(BENCH_DB);
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(conn, "SELECT id, title, description, completed, user_id, created_at, updated_at FROM tasks WHERE id = 1;",
+                       -1, &stmt, nullptr);
+    sqlite3_step(stmt);
+    auto dom_row = bench::run("row_to_json_task + dump", [&] {
+        bench::do_not_optimize(row_to_json_task(stmt).dump());
+    });
+    JsonRowWriter writer(stmt);
+    auto direct_row = bench::run("JsonRowWriter::write_row", [&] {
+        out.clear();
+        writer.write_row(stmt, out);
+        bench::do_not_optimize(out);
+    });
+    std::printf("  speedup x%.2f\n", dom_row.ns_per_op / direct_row.ns_per_op);
+
+    auto dom_response = bench::run("response envelope (DOM)", [&] {
+        nlohmann::json response = {{"success", true}, {"message", "Task retrieved successfully"}};
+        response["data"] = row_to_json_task(stmt);
+        bench::do_not_optimize(response.dump());
+    });
+    auto direct_response = bench::run("response envelope (JsonRowWriter)", [&] {
+        out.clear();
+        out += "{\"success\":true,\"message\":";
+        JsonRowWriter::append_string(out, "Task retrieved successfully");
+        out += ",\"data\":";
+        writer.write_row(stmt, out);
+        out += '}';
+        bench::do_not_optimize(out);
+    });
+    std::printf("  speedup x%.2f\n", dom_response.ns_per_op / direct_response.ns_per_op);
+    sqlite3_finalize(stmt);
+    sqlite3_close(conn);
+
+    bool written = bench::write_report(argc, argv, "database");
+    remove_database();
+    return written ? 0 : 1;
+}
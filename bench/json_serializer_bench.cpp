@@ -0,0 +1,106 @@
+// Compares the nlohmann::json DOM path against JsonRowWriter for task pages.
+#include "bench_util.h"
+#include "connection_pool.h"
+#include "database.h"
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+namespace {
+    const char* BENCH_DB = "json_serializer_bench.db";
+    const int TASK_COUNT = 5000;
+
+    void seed(Database& db) {
+        db.execute("DELETE FROM tasks; DELETE FROM users;");
+        db.create_user("bench", "bench@example.com", "hash");
+        int user_id = db.get_user_by_username("bench")["id"];
+        std::vector<TaskBatchItem> items(TASK_COUNT);
+        for (int i = 0; i < TASK_COUNT; ++i) {
+            items[i].title = "Task \"" + std::to_string(i) + "\" to finish";
+            items[i].description = "Line one\nLine two with some longer descriptive text";
+        }
+        std::vector<TaskBatchResult> results(TASK_COUNT);
+        db.create_tasks(user_id, items, results);
+    }
+
+    // The old DOM path, kept here as the baseline: one nlohmann::json object per row
+    nlohmann::json row_to_json(sqlite3_stmt* stmt) {
+        nlohmann::json row = nlohmann::json::object();
+        int count = sqlite3_column_count(stmt);
+        for (int i = 0; i < count; ++i) {
+            const char* name = sqlite3_column_name(stmt, i);
+            switch (sqlite3_column_type(stmt, i)) {
+                case SQLITE_INTEGER:
+                    if (std::strcmp(name, "completed") == 0) {
+                        row[name] = sqlite3_column_int(stmt, i) == 1;
+                    } else {
+                        row[name] = sqlite3_column_int64(stmt, i);
+                    }
+                    break;
+                case SQLITE_NULL:
+                    row[name] = nullptr;
+                    break;
+                default:
+                    row[name] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+                    break;
+            }
+        }
+        return row;
+    }
+
+    std::vector<nlohmann::json> dom_page(sqlite3_stmt* stmt, int limit) {
+        std::vector<nlohmann::json> items;
+        items.reserve(limit);
+        sqlite3_reset(stmt);
+        sqlite3_bind_int(stmt, 1, limit);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            items.push_back(row_to_json(stmt));
+        }
+        return items;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::remove(BENCH_DB);
+    Database db(BENCH_DB, 1);
+    if (!db.initialize()) {
+        std::cerr << "Failed to initialize benchmark database" << std::endl;
+        return 1;
+    }
+    seed(db);
+
+    sqlite3* conn = ConnectionPool::open_connection(BENCH_DB);
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(conn, "SELECT id, title, description, completed, user_id, created_at, updated_at FROM tasks ORDER BY id LIMIT ?;",
+                       -1, &stmt, nullptr);
+
+    for (int limit : {1, 50, 1000}) {
+        PageQuery query;
+        query.limit = limit;
+
+        auto dom = bench::run("dom page limit=" + std::to_string(limit), [&] {
+            nlohmann::json response = {{"success", true}, {"message", "Tasks retrieved successfully"}};
+            response["data"] = dom_page(stmt, limit);
+            std::string body = response.dump();
+            bench::do_not_optimize(body);
+        });
+
+        std::string body;
+        auto direct = bench::run("writer page limit=" + std::to_string(limit), [&] {
+            body.clear();
+            std::optional<int> next_cursor;
+            body += "{\"success\":true,\"message\":\"Tasks retrieved successfully\",\"data\":";
+            db.write_all_tasks(query, body, next_cursor);
+            body += '}';
+            bench::do_not_optimize(body);
+        });
+
+        std::printf("  speedup x%.2f, %.1f ns/row saved\n\n", dom.ns_per_op / direct.ns_per_op,
+                    (dom.ns_per_op - direct.ns_per_op) / limit);
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite3_close(conn);
+    std::remove(BENCH_DB);
+    return bench::write_report(argc, argv, "json_serializer") ? 0 : 1;
+}
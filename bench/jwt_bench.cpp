@@ -0,0 +1,63 @@
+// Token verification throughput: the previous decimal-encoded token format
+// (reproduced here as the baseline) vs. AuthService's HS256 JWTs.
+#include "bench_util.h"
+#include "auth_service.h"
+#include <chrono>
+#include <nlohmann/json.hpp>
+#include <sstream>
+
+namespace {
+    std::string legacy_generate(int user_id, const std::string& username) {
+        nlohmann::json payload;
+        payload["user_id"] = user_id;
+        payload["username"] = username;
+        auto now = std::chrono::system_clock::now();
+        auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+        payload["exp"] = timestamp + 24 * 3600;
+
+        std::string encoded;
+        for (char c : payload.dump()) {
+            encoded += std::to_string(static_cast<int>(c)) + ".";
+        }
+        return encoded;
+    }
+
+    std::optional<std::pair<int, std::string>> legacy_verify(const std::string& token) {
+        std::string decoded;
+        std::stringstream ss(token);
+        std::string segment;
+        while (std::getline(ss, segment, '.')) {
+            if (!segment.empty()) {
+                decoded += static_cast<char>(std::stoi(segment));
+            }
+        }
+        auto payload = nlohmann::json::parse(decoded);
+        auto now = std::chrono::system_clock::now();
+        auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+        if (payload["exp"].get<long>() < timestamp) {
+            return std::nullopt;
+        }
+        return std::make_pair(payload["user_id"].get<int>(), payload["username"].get<std::string>());
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string legacy_token = legacy_generate(12345, "benchmark_user");
+    std::string jwt = AuthService::generate_jwt_token(12345, "benchmark_user");
+    std::printf("token size: legacy %zu bytes, jwt %zu bytes\n\n", legacy_token.size(), jwt.size());
+
+    auto legacy = bench::run("legacy verify", [&] {
+        bench::do_not_optimize(legacy_verify(legacy_token));
+    });
+    auto current = bench::run("AuthService::verify_jwt_token (HS256)", [&] {
+        bench::do_not_optimize(AuthService::verify_jwt_token(jwt));
+    });
+
+    std::printf("\ntokens verified per second per core: legacy %.0f, jwt %.0f\n",
+                1e9 / legacy.ns_per_op, 1e9 / current.ns_per_op);
+
+    bench::run("AuthService::generate_jwt_token", [&] {
+        bench::do_not_optimize(AuthService::generate_jwt_token(12345, "benchmark_user"));
+    });
+    return bench::write_report(argc, argv, "jwt") ? 0 : 1;
+}
@@ -0,0 +1,510 @@
+// Self-contained HTTP load generator. Seeds N users and M tasks into a temporary
+// database, starts the server binary against it, drives a weighted mix of /api
+// routes from several keep-alive connections and prints throughput and latency
+// percentiles as JSON.
+//
+//   loadgen --server ./build/RestAPI [--users 100] [--tasks 10000] [--threads 8]
+//           [--duration 10] [--warmup 1] [--port 18080] [--json out.json]
+//           [--mix get_task=40,list_tasks=15,user_tasks=15,get_user=10,create_task=10,update_task=5,health=5]
+//           [--sweep IO_THREADS=3,4,8,16]
+//
+// --sweep repeats the whole run (fresh database and server) once per value, with
+// that environment variable set for the server, and reports every run side by side.
+#include "auth_service.h"
+#include "database.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    struct Options {
+        std::string server = "./RestAPI";
+        int users = 100;
+        int tasks = 10000;
+        int threads = 8;
+        int duration = 10;
+        int warmup = 1;
+        int port = 18080;
+        std::string mix = "get_task=40,list_tasks=15,user_tasks=15,get_user=10,create_task=10,update_task=5,health=5";
+        std::string json_path;
+        std::string sweep_variable;
+        std::vector<std::string> sweep_values;
+    };
+
+    const char* OPERATIONS[] = {"health", "get_user", "get_task", "list_tasks", "user_tasks", "create_task", "update_task"};
+    const size_t OPERATION_COUNT = sizeof(OPERATIONS) / sizeof(OPERATIONS[0]);
+
+    struct Dataset {
+        int users = 0;
+        int tasks_per_user = 0;
+        std::vector<std::string> tokens;    // tokens[user - 1]
+    };
+
+    bool parse_options(int argc, char** argv, Options& options) {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            std::string flag = argv[i];
+            std::string value = argv[i + 1];
+            if (flag == "--server") options.server = value;
+            else if (flag == "--users") options.users = std::atoi(value.c_str());
+            else if (flag == "--tasks") options.tasks = std::atoi(value.c_str());
+            else if (flag == "--threads") options.threads = std::atoi(value.c_str());
+            else if (flag == "--duration") options.duration = std::atoi(value.c_str());
+            else if (flag == "--warmup") options.warmup = std::atoi(value.c_str());
+            else if (flag == "--port") options.port = std::atoi(value.c_str());
+            else if (flag == "--mix") options.mix = value;
+            else if (flag == "--json") options.json_path = value;
+            else if (flag == "--sweep") {
+                size_t equals = value.find('=');
+                if (equals == std::string::npos || equals == 0) {
+                    return false;
+                }
+                options.sweep_variable = value.substr(0, equals);
+                for (size_t start = equals + 1; start <= value.size();) {
+                    size_t end = std::min(value.find(',', start), value.size());
+                    if (end > start) {
+                        options.sweep_values.push_back(value.substr(start, end - start));
+                    }
+                    start = end + 1;
+                }
+            }
+            else return false;
+        }
+        return options.users > 0 && options.tasks >= options.users && options.threads > 0 && options.duration > 0;
+    }
+
+    // "name=weight,..." into one weight per entry of OPERATIONS
+    bool parse_mix(const std::string& mix, std::vector<int>& weights) {
+        weights.assign(OPERATION_COUNT, 0);
+        size_t start = 0;
+        while (start < mix.size()) {
+            size_t end = mix.find(',', start);
+            std::string entry = mix.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            size_t equals = entry.find('=');
+            if (equals == std::string::npos) {
+                return false;
+            }
+            auto op = std::find(OPERATIONS, OPERATIONS + OPERATION_COUNT, entry.substr(0, equals));
+            if (op == OPERATIONS + OPERATION_COUNT) {
+                return false;
+            }
+            weights[op - OPERATIONS] = std::atoi(entry.c_str() + equals + 1);
+            if (end == std::string::npos) {
+                break;
+            }
+            start = end + 1;
+        }
+        return std::any_of(weights.begin(), weights.end(), [](int weight) { return weight > 0; });
+    }
+
+    bool seed(const std::string& db_path, const Options& options, Dataset& dataset) {
+        Database db(db_path);
+        if (!db.initialize()) {
+            return false;
+        }
+
+        dataset.users = options.users;
+        dataset.tasks_per_user = options.tasks / options.users;
+        std::string password_hash = AuthService::hash_password("password");
+        for (int user = 1; user <= options.users; ++user) {
+            std::string name = "user" + std::to_string(user);
+            if (!db.create_user(name, name + "@example.com", password_hash)) {
+                return false;
+            }
+            dataset.tokens.push_back(AuthService::generate_jwt_token(user, name));
+
+            // Users own contiguous id ranges, so workers can pick tasks they may update
+            std::vector<TaskBatchItem> items(dataset.tasks_per_user);
+            for (int i = 0; i < dataset.tasks_per_user; ++i) {
+                items[i].title = "Task " + std::to_string(i) + " for " + name;
+                items[i].description = "Seeded by the load generator";
+            }
+            std::vector<TaskBatchResult> results(items.size());
+            if (!db.create_tasks(user, items, results)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // One keep-alive HTTP/1.1 connection; responses are framed by Content-Length
+    class Connection {
+    public:
+        explicit Connection(int port) : port(port) {}
+        ~Connection() { close_socket(); }
+
+        // Returns the status code, or 0 on a transport error
+        int send(const std::string& request) {
+            if (fd < 0 && !open_socket()) {
+                return 0;
+            }
+            if (!write_all(request)) {
+                close_socket();
+                return 0;
+            }
+            int status = read_response();
+            if (status == 0) {
+                close_socket();
+            }
+            return status;
+        }
+
+    private:
+        int port;
+        int fd = -1;
+        std::string buffer;
+
+        bool open_socket() {
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0) {
+                return false;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(static_cast<uint16_t>(port));
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+                close_socket();
+                return false;
+            }
+            buffer.clear();
+            return true;
+        }
+
+        void close_socket() {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+
+        bool write_all(const std::string& data) {
+            size_t sent = 0;
+            while (sent < data.size()) {
+                ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    return false;
+                }
+                sent += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        bool fill() {
+            char chunk[16 * 1024];
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                return false;
+            }
+            buffer.append(chunk, static_cast<size_t>(n));
+            return true;
+        }
+
+        int read_response() {
+            size_t header_end;
+            while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                if (!fill()) {
+                    return 0;
+                }
+            }
+
+            int status = 0;
+            if (buffer.compare(0, 5, "HTTP/") != 0 || std::sscanf(buffer.c_str() + buffer.find(' ') + 1, "%d", &status) != 1) {
+                return 0;
+            }
+
+            size_t content_length = 0;
+            std::string headers = buffer.substr(0, header_end);
+            std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+            size_t field = headers.find("\r\ncontent-length:");
+            if (field != std::string::npos) {
+                content_length = std::strtoul(headers.c_str() + field + 17, nullptr, 10);
+            }
+
+            size_t total = header_end + 4 + content_length;
+            while (buffer.size() < total) {
+                if (!fill()) {
+                    return 0;
+                }
+            }
+            buffer.erase(0, total);
+            return status;
+        }
+    };
+
+    std::string build_request(const char* method, const std::string& path, const std::string* token = nullptr,
+                              const std::string& body = std::string()) {
+        std::string request = std::string(method) + " " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n";
+        if (token) {
+            request += "Authorization: Bearer " + *token + "\r\n";
+        }
+        if (!body.empty()) {
+            request += "Content-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+        }
+        request += "\r\n";
+        request += body;
+        return request;
+    }
+
+    struct WorkerStats {
+        std::vector<std::vector<uint32_t>> latencies_us{OPERATION_COUNT};
+        std::vector<uint64_t> errors = std::vector<uint64_t>(OPERATION_COUNT, 0);
+    };
+
+    void run_worker(int port, const Dataset& dataset, const std::vector<int>& weights, unsigned seed,
+                    clock_type::time_point measure_from, clock_type::time_point stop_at,
+                    const std::atomic<bool>& failed, WorkerStats& stats) {
+        std::mt19937 random(seed);
+        std::discrete_distribution<size_t> pick_operation(weights.begin(), weights.end());
+        std::uniform_int_distribution<int> pick_user(1, dataset.users);
+        std::uniform_int_distribution<int> pick_offset(0, dataset.tasks_per_user - 1);
+        int task_count = dataset.users * dataset.tasks_per_user;
+        Connection connection(port);
+
+        while (!failed.load(std::memory_order_relaxed)) {
+            auto start = clock_type::now();
+            if (start >= stop_at) {
+                break;
+            }
+
+            size_t op = pick_operation(random);
+            int user = pick_user(random);
+            int task = (user - 1) * dataset.tasks_per_user + pick_offset(random) + 1;
+            const std::string& token = dataset.tokens[user - 1];
+            std::string request;
+            switch (op) {
+                case 0: request = build_request("GET", "/api/health"); break;
+                case 1: request = build_request("GET", "/api/users/" + std::to_string(user)); break;
+                case 2: request = build_request("GET", "/api/tasks/" + std::to_string(task)); break;
+                case 3: request = build_request("GET", "/api/tasks?limit=50&after=" + std::to_string(task % std::max(1, task_count - 50))); break;
+                case 4: request = build_request("GET", "/api/users/" + std::to_string(user) + "/tasks?limit=50"); break;
+                case 5: request = build_request("POST", "/api/tasks", &token, R"({"title":"Load test","description":"Created by loadgen"})"); break;
+                default: request = build_request("PATCH", "/api/tasks/" + std::to_string(task), &token, R"({"completed":true})"); break;
+            }
+
+            int status = connection.send(request);
+            auto finished = clock_type::now();
+            if (start < measure_from) {
+                continue;
+            }
+            if (status < 200 || status >= 400) {
+                ++stats.errors[op];
+            }
+            stats.latencies_us[op].push_back(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(finished - start).count()));
+        }
+    }
+
+    double percentile_ms(const std::vector<uint32_t>& sorted, double q) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        size_t index = std::min(sorted.size() - 1, static_cast<size_t>(q * sorted.size()));
+        return sorted[index] / 1000.0;
+    }
+
+    nlohmann::json summarize(std::vector<uint32_t>& latencies, uint64_t errors, double seconds) {
+        std::sort(latencies.begin(), latencies.end());
+        return {
+            {"requests", latencies.size()},
+            {"errors", errors},
+            {"throughput_rps", latencies.size() / seconds},
+            {"p50_ms", percentile_ms(latencies, 0.50)},
+            {"p90_ms", percentile_ms(latencies, 0.90)},
+            {"p99_ms", percentile_ms(latencies, 0.99)},
+            {"p999_ms", percentile_ms(latencies, 0.999)},
+            {"max_ms", latencies.empty() ? 0.0 : latencies.back() / 1000.0}
+        };
+    }
+
+    // setting is an extra NAME=value for the server's environment (empty for none)
+    pid_t start_server(const Options& options, const std::string& db_path, const std::string& setting) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (!setting.empty()) {
+                putenv(const_cast<char*>(setting.c_str()));
+            }
+            setenv("DB_PATH", db_path.c_str(), 1);
+            setenv("PORT", std::to_string(options.port).c_str(), 1);
+            int devnull = open("/dev/null", O_WRONLY);
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+            execl(options.server.c_str(), options.server.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        return pid;
+    }
+
+    bool wait_for_server(int port, pid_t pid) {
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            int status;
+            if (waitpid(pid, &status, WNOHANG) == pid) {
+                return false;
+            }
+            Connection probe(port);
+            if (probe.send(build_request("GET", "/api/health")) == 200) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        return false;
+    }
+
+    // Seeds a fresh database, starts the server with setting in its environment and drives load
+    bool run_load(const Options& options, const std::vector<int>& weights, const std::string& setting,
+                  nlohmann::json& report) {
+        char dir_template[] = "/tmp/restapi-loadgen-XXXXXX";
+        if (!mkdtemp(dir_template)) {
+            std::cerr << "Failed to create a temporary directory" << std::endl;
+            return false;
+        }
+        std::string dir = dir_template;
+        std::string db_path = dir + "/loadgen.db";
+        auto cleanup = [&]() {
+            for (const char* suffix : {"", "-wal", "-shm"}) {
+                std::remove((db_path + suffix).c_str());
+            }
+            rmdir(dir.c_str());
+        };
+
+        Dataset dataset;
+        std::cerr << "Seeding " << options.users << " users / " << options.tasks << " tasks..." << std::endl;
+        if (!seed(db_path, options, dataset)) {
+            std::cerr << "Failed to seed the database" << std::endl;
+            cleanup();
+            return false;
+        }
+
+        pid_t server = start_server(options, db_path, setting);
+        if (server < 0 || !wait_for_server(options.port, server)) {
+            std::cerr << "Server did not become healthy: " << options.server << std::endl;
+            if (server > 0) {
+                kill(server, SIGKILL);
+                waitpid(server, nullptr, 0);
+            }
+            cleanup();
+            return false;
+        }
+
+        std::cerr << "Running " << options.threads << " connections for " << options.duration << "s (+"
+                  << options.warmup << "s warm-up)..." << std::endl;
+        auto measure_from = clock_type::now() + std::chrono::seconds(options.warmup);
+        auto stop_at = measure_from + std::chrono::seconds(options.duration);
+        std::atomic<bool> failed{false};
+        std::vector<WorkerStats> stats(options.threads);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < options.threads; ++t) {
+            workers.emplace_back(run_worker, options.port, std::cref(dataset), std::cref(weights), 1234u + t,
+                                 measure_from, stop_at, std::cref(failed), std::ref(stats[t]));
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        kill(server, SIGINT);
+        waitpid(server, nullptr, 0);
+        cleanup();
+
+        double seconds = options.duration;
+        std::vector<uint32_t> all;
+        uint64_t all_errors = 0;
+        nlohmann::json routes = nlohmann::json::object();
+        for (size_t op = 0; op < OPERATION_COUNT; ++op) {
+            std::vector<uint32_t> merged;
+            uint64_t errors = 0;
+            for (auto& worker : stats) {
+                merged.insert(merged.end(), worker.latencies_us[op].begin(), worker.latencies_us[op].end());
+                errors += worker.errors[op];
+            }
+            if (weights[op] == 0) {
+                continue;
+            }
+            all.insert(all.end(), merged.begin(), merged.end());
+            all_errors += errors;
+            routes[OPERATIONS[op]] = summarize(merged, errors, seconds);
+        }
+
+        report = {
+            {"config", {
+                {"users", options.users},
+                {"tasks", dataset.users * dataset.tasks_per_user},
+                {"threads", options.threads},
+                {"duration_s", options.duration},
+                {"warmup_s", options.warmup},
+                {"mix", options.mix}
+            }},
+            {"total", summarize(all, all_errors, seconds)},
+            {"routes", routes}
+        };
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<int> weights;
+    if (!parse_options(argc, argv, options) || !parse_mix(options.mix, weights)) {
+        std::cerr << "usage: loadgen --server <path> [--users N] [--tasks M] [--threads T] [--duration S] "
+                     "[--warmup S] [--port P] [--mix op=weight,...] [--sweep VAR=v1,v2,...] [--json path]" << std::endl;
+        return 2;
+    }
+
+    nlohmann::json report;
+    if (options.sweep_values.empty()) {
+        if (!run_load(options, weights, std::string(), report)) {
+            return 1;
+        }
+    } else {
+        report = {{"variable", options.sweep_variable}, {"runs", nlohmann::json::array()}};
+        for (const auto& value : options.sweep_values) {
+            std::cerr << "== " << options.sweep_variable << "=" << value << std::endl;
+            nlohmann::json run;
+            if (!run_load(options, weights, options.sweep_variable + "=" + value, run)) {
+                return 1;
+            }
+            run["value"] = value;
+            report["runs"].push_back(run);
+        }
+
+        std::fprintf(stderr, "\n%-16s %12s %10s %10s %10s %8s\n", options.sweep_variable.c_str(),
+                     "req/s", "p50 ms", "p99 ms", "p99.9 ms", "errors");
+        for (const auto& run : report["runs"]) {
+            const auto& total = run["total"];
+            std::fprintf(stderr, "%-16s %12.0f %10.3f %10.3f %10.3f %8llu\n",
+                         run["value"].get<std::string>().c_str(), total["throughput_rps"].get<double>(),
+                         total["p50_ms"].get<double>(), total["p99_ms"].get<double>(), total["p999_ms"].get<double>(),
+                         static_cast<unsigned long long>(total["errors"].get<uint64_t>()));
+        }
+    }
+
+    std::cout << report.dump(2) << std::endl;
+    if (!options.json_path.empty()) {
+        std::ofstream out(options.json_path);
+        out << report.dump(2) << '\n';
+        if (!out) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Admission control in front of the route handlers. Crow runs handlers on its
+// io threads (all but the acceptor) and a handler blocks its thread for the
+// whole request, so a spike that reaches SQLite stalls every thread, health
+// checks included. Each request takes a slot before running its handler:
+//
+//   - at most `capacity` non-critical requests run at once, fewer per class
+//     (writes 3/4, bulk writes 1/4 of capacity) and optionally per route;
+//   - requests that find no slot wait in a bounded queue up to max_wait; a
+//     freed slot goes to the oldest waiter of the highest-priority class that
+//     may run, and a request is shed (503) when the queue is full or its wait
+//     runs out.
+//
+// A waiting request blocks its io thread, and with it every other connection
+// that thread serves (health checks too) until it is admitted or shed, so the
+// default queue is short and its wait brief. Critical routes never queue;
+// capacity + queue leave RESERVED_THREADS handler threads to answer them.
+class AdmissionController {
+public:
+    enum class Priority { Critical, Read, Write, Bulk, Count };
+
+    // Handler threads that admitted and queued requests never take, for critical routes
+    static constexpr size_t RESERVED_THREADS = 1;
+
+    struct Config {
+        size_t worker_threads = 0;  // threads Crow runs handlers on; 0 = hardware threads less the acceptor
+        size_t capacity = 0;        // 0 = the unreserved handler threads less the queue
+        std::optional<size_t> max_queued;   // requests that may wait for a slot; unset = a quarter of the
+                                            // unreserved handler threads, 0 = shed at once
+        std::chrono::milliseconds max_wait{50};        // how long a queued request waits
+        std::map<std::string, size_t> route_limits;    // route label -> max concurrent
+    };
+
+    // Fills in worker_threads, capacity and max_queued where config leaves them to the
+    // defaults; with defaults alone, capacity + queue + RESERVED_THREADS fits the workers
+    static Config resolve(Config config);
+
+    struct ClassStats {
+        size_t in_flight = 0;
+        size_t queued = 0;
+        uint64_t admitted = 0;
+        uint64_t shed_queue_full = 0;
+        uint64_t shed_deadline = 0;
+    };
+
+    // Releases its slot (and hands it to a waiter) when destroyed
+    class Ticket {
+    public:
+        Ticket(AdmissionController* controller, size_t route) : controller(controller), route(route) {}
+        Ticket(Ticket&& other) noexcept : controller(other.controller), route(other.route) { other.controller = nullptr; }
+        Ticket& operator=(Ticket&&) = delete;
+        Ticket(const Ticket&) = delete;
+        ~Ticket() {
+            if (controller) {
+                controller->release(route);
+            }
+        }
+
+    private:
+        AdmissionController* controller;
+        size_t route;
+    };
+
+    static constexpr size_t MAX_ROUTES = 64;
+
+    explicit AdmissionController(const Config& config);
+
+    AdmissionController(const AdmissionController&) = delete;
+    AdmissionController& operator=(const AdmissionController&) = delete;
+
+    // Sets the class (and any configured limit) of a route id; ids are Metrics route ids
+    void add_route(size_t route, const std::string& label, Priority priority);
+
+    // Blocks up to max_wait for a slot; nullopt means the request must be shed
+    std::optional<Ticket> admit(size_t route);
+
+    static const char* priority_name(Priority priority);
+    ClassStats stats(Priority priority) const;
+    size_t capacity() const { return total_capacity; }
+
+private:
+    struct Waiter {
+        size_t route;
+        bool granted = false;
+        std::condition_variable ready;
+    };
+
+    struct RouteState {
+        Priority priority = Priority::Read;
+        size_t limit = 0;           // 0 = only the class limit applies
+        size_t in_flight = 0;
+    };
+
+    static constexpr size_t CLASS_COUNT = static_cast<size_t>(Priority::Count);
+
+    size_t total_capacity;
+    size_t max_queued;
+    std::chrono::milliseconds max_wait;
+    std::map<std::string, size_t> route_limits;
+    std::array<size_t, CLASS_COUNT> class_limits{};
+    std::array<size_t, CLASS_COUNT> class_max_queued{};
+
+    mutable std::mutex mutex;
+    std::array<RouteState, MAX_ROUTES + 1> routes{};     // the last one is for unregistered routes
+    std::array<std::deque<Waiter*>, CLASS_COUNT> queues;
+    std::array<ClassStats, CLASS_COUNT> classes{};
+    size_t in_flight = 0;
+    size_t queued = 0;
+
+    bool can_run_locked(size_t route) const;
+    void start_locked(size_t route);
+    void dispatch_locked();
+    void release(size_t route);
+};
@@ -1,36 +1,108 @@
 #pragma once
 #include <crow.h>
 #include <nlohmann/json.hpp>
+#include "admission_controller.h"
+#include "body_format.h"
+#include "change_hub.h"
 #include "database.h"
+#include "password_hasher.h"
+#include "request_arena.h"
+#include "response_compressor.h"
+#include "response_cache.h"
+#include "server_config.h"
+#include "token_cache.h"
+#include <mutex>
+#include <unordered_map>
 
 class APIRoutes {
 public:
-    APIRoutes(std::shared_ptr<Database> db);
+    APIRoutes(std::shared_ptr<Database> db, const ServerConfig& config = ServerConfig());
     void setup_routes(crow::SimpleApp& app);
 
 private:
     std::shared_ptr<Database> database;
+    ResponseCache response_cache;
+    TokenCache token_cache;
+    PasswordHasher password_hasher;
+    AdmissionController admission;
+    ChangeHub change_hub;
+    ResponseCompressor compressor;
+    size_t max_body_bytes;
+    std::vector<int> worker_cpus;       // pin each worker on its first request (empty = no pinning)
     
     // Utility methods
-    nlohmann::json create_error_response(const std::string& message, int code = 400);
-    nlohmann::json create_success_response(const std::string& message, const nlohmann::json& data = nlohmann::json::object());
+    RequestJson create_error_response(const std::string& message, int code = 400);
+    RequestJson create_success_response(const std::string& message, RequestJson data = RequestJson::object());
     std::optional<std::pair<int, std::string>> authenticate_request(const crow::request& req);
+    RequestJson parse_body(const crow::request& req);
+    
+    // Route ids label per-route counters and admission classes; observe() admits, times
+    // and records a handler, shedding it with 503 when admission control refuses it;
+    // the request overload first answers 413 for bodies over max_body_bytes, and encodes
+    // the response for the request's Accept and Accept-Encoding (see encoded())
+    size_t route_id(const char* label);
+    static AdmissionController::Priority route_priority(const std::string& label);
+    crow::response observe(size_t route, const std::function<crow::response()>& handler);
+    crow::response observe(size_t route, const crow::request& req, const std::function<crow::response()>& handler);
+    void register_metrics();
+    PageQuery parse_page_query(const crow::request& req);
+    static int parse_limit(const char* limit);
+    
+    // Responses built from serialized rows (see JsonRowWriter); bodies are assembled in a per-thread buffer
+    using PageWriter = std::function<bool(std::string& out, std::optional<int>& next_cursor)>;
+    using RowWriter = std::function<bool(std::string& out)>;
+    crow::response page_response(const std::string& message, const PageQuery& query, const PageWriter& writer);
+    crow::response row_response(const std::string& message, const std::string& not_found_message, const RowWriter& writer);
+    crow::response json_response(int code, const std::string& body);
+    crow::response busy_response();
+    static std::string& response_buffer();
+    // Serves req from the response cache (or 304 on If-None-Match); on a miss build() renders
+    // the body and reports the owning user, whose writes invalidate the entry
+    crow::response cached_response(const crow::request& req, const std::function<crow::response(int& owner_id)>& build);
+    static void begin_success_body(std::string& out, const std::string& message);
+    bool wants_export(const crow::request& req);
+    // One buffered response of up to Database::MAX_EXPORT_BYTES of rows (see "next_cursor");
+    // 500 if the read fails
+    crow::response export_response(const std::string& message, const PageWriter& writer);
+    // Converts a JSON success body to the format the client accepts (unless transcode is false,
+    // as for exports) and compresses it; cached_response does the same before caching,
+    // so each representation is cached with its own ETag
+    crow::response encoded(const crow::request& req, crow::response res, bool transcode = true);
+    bool transcode_body(BodyFormat::Format format, std::string& body);
+    bool compress_body(ResponseCompressor::Encoding encoding, std::string& body);
     
     // Auth routes
     crow::response login(const crow::request& req);
     crow::response register_user(const crow::request& req);
     
     // User routes
-    crow::response get_users();
+    crow::response get_users(const crow::request& req);
     crow::response get_user(int user_id);
     crow::response update_user(const crow::request& req, int user_id);
     crow::response delete_user(const crow::request& req, int user_id);
     
     // Task routes
-    crow::response get_tasks();
+    crow::response get_tasks(const crow::request& req);
     crow::response create_task(const crow::request& req);
-    crow::response get_task(int task_id);
+    crow::response get_task(const crow::request& req, int task_id);
     crow::response update_task(const crow::request& req, int task_id);
     crow::response delete_task(const crow::request& req, int task_id);
-    crow::response get_user_tasks(int user_id);
+    crow::response get_user_tasks(const crow::request& req, int user_id);
+    crow::response search_tasks(const crow::request& req);
+    crow::response get_task_changes(const crow::request& req);
+    
+    // Push: /api/ws subscribers receive their user's task changes from change_hub
+    std::mutex push_mutex;
+    std::unordered_map<crow::websocket::connection*, ChangeHub::SubscriberId> push_subscribers;
+    void handle_push_message(crow::websocket::connection& conn, const std::string& data);
+    void close_push_connection(crow::websocket::connection& conn);
+    static std::string push_error(const std::string& message);
+    
+    // Batch task routes: per-item results, one transaction per request
+    crow::response create_tasks_batch(const crow::request& req);
+    crow::response update_tasks_batch(const crow::request& req);
+    crow::response delete_tasks_batch(const crow::request& req);
+    const RequestJson& batch_items(const RequestJson& body, const char* key);
+    static bool parse_batch_item(const RequestJson& element, bool requires_id, TaskBatchItem& item, std::string& error);
+    crow::response batch_response(const std::string& message, const std::vector<TaskBatchResult>& results);
 };
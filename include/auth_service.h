@@ -1,15 +1,42 @@
 #pragma once
+#include <atomic>
 #include <string>
 #include <optional>
+#include <string_view>
 
 class AuthService {
 public:
+    // PBKDF2-HMAC-SHA256 with a random per-user salt, encoded as
+    // pbkdf2_sha256$<iterations>$<salt>$<hash> (base64url). CPU-heavy by design:
+    // call through PasswordHasher, not on a request thread.
     static std::string hash_password(const std::string& password);
+    // Accepts encoded PBKDF2 hashes and the legacy unsalted format
     static bool verify_password(const std::string& password, const std::string& hash);
+    // True for legacy hashes and PBKDF2 hashes below the configured iteration count
+    static bool needs_rehash(const std::string& hash);
+    static void set_pbkdf2_iterations(int iterations);
+    static int pbkdf2_iterations();
+    
+    // HS256-signed JWTs (base64url header.payload.signature)
+    struct TokenClaims {
+        int user_id = 0;
+        std::string username;
+        long long issued_at = 0;
+        long long expires_at = 0;
+    };
+    
     static std::string generate_jwt_token(int user_id, const std::string& username);
-    static std::optional<std::pair<int, std::string>> verify_jwt_token(const std::string& token);
+    // Checks header, signature and expiry; parses the payload without building a JSON DOM
+    static std::optional<TokenClaims> decode_jwt_token(std::string_view token);
+    static std::optional<std::pair<int, std::string>> verify_jwt_token(std::string_view token);
+    static long long token_lifetime_seconds() { return JWT_EXPIRY_HOURS * 3600LL; }
     
 private:
+    static bool sign(std::string_view signing_input, unsigned char* signature);
+    static bool parse_claims(std::string_view payload, TokenClaims& claims);
+    static std::string legacy_hash_password(const std::string& password);
+    
     static const std::string JWT_SECRET;
     static const int JWT_EXPIRY_HOURS;
+    static std::atomic<int> PBKDF2_ITERATIONS;
 };
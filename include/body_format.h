@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "input_validator.h"
+
+// Wire formats for API bodies. JSON is the default; clients that send
+// Accept: application/msgpack or application/cbor get the same document in
+// that encoding, and write routes take request bodies in either when the
+// Content-Type says so. Error responses stay JSON.
+class BodyFormat {
+public:
+    enum class Format { Json, MsgPack, Cbor };
+
+    // Transcoding scratch a thread keeps between requests; more is released after use
+    static constexpr size_t MAX_RETAINED_BYTES = 1024 * 1024;
+
+    // Preferred format of an Accept header; JSON unless a binary type is listed
+    // with a higher q-value than JSON (so */* and a missing header mean JSON)
+    static Format from_accept(const std::string& accept);
+    // Format of a request body by its Content-Type (parameters ignored); JSON by default
+    static Format from_content_type(const std::string& content_type);
+
+    static const char* content_type(Format format);
+    static const char* name(Format format);
+
+    // Throws nlohmann::json::exception on malformed input, including strings that are not
+    // UTF-8; Json is any nlohmann::basic_json (the routes parse into RequestJson)
+    template <typename Json = nlohmann::json>
+    static Json parse(Format format, const std::string& body) {
+        if (format == Format::Json) {
+            return Json::parse(body);
+        }
+        
+        // The JSON parser rejects malformed UTF-8 but from_msgpack/from_cbor take any bytes,
+        // so their strings are checked here and never reach the database
+        Json document = format == Format::MsgPack ? Json::from_msgpack(body) : Json::from_cbor(body);
+        check_utf8(document);
+        return document;
+    }
+    // Re-encodes a JSON text body in place; false (body untouched) when it is not valid JSON
+    static bool transcode(Format format, std::string& body);
+
+private:
+    // Walks every string and object key without serializing the document. A bad one is
+    // dumped on its own, so the error thrown is the type_error a strict dump() raises.
+    template <typename Json>
+    static void check_utf8(const Json& document) {
+        std::vector<const Json*> pending{&document};
+        while (!pending.empty()) {
+            const Json& value = *pending.back();
+            pending.pop_back();
+            if (value.is_string()) {
+                const auto& text = value.template get_ref<const typename Json::string_t&>();
+                if (!InputValidator::is_valid_utf8(text)) {
+                    (void)Json(text).dump();
+                }
+            } else if (value.is_object()) {
+                for (auto it = value.begin(); it != value.end(); ++it) {
+                    if (!InputValidator::is_valid_utf8(it.key())) {
+                        (void)Json(it.key()).dump();
+                    }
+                    pending.push_back(&it.value());
+                }
+            } else if (value.is_array()) {
+                for (const Json& element : value) {
+                    pending.push_back(&element);
+                }
+            }
+        }
+    }
+};
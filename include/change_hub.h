@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "database.h"
+
+// In-process fan-out of the task change feed to push subscribers (the /api/ws
+// WebSocket). Write routes only call notify(); one publisher thread reads the
+// new task_changes rows, so pushed events carry the same seq as
+// GET /api/tasks/changes and arrive in commit order.
+//
+// Each subscriber has an ack window: the seqs and sizes of events sent but not
+// yet acknowledged, kept in a ring. Events the connection has not written out
+// yet are among them, so the window also bounds what the hub can leave queued
+// on a connection. A subscriber whose window holds ring_capacity events or
+// MAX_PENDING_BYTES is a slow consumer: it is closed and dropped instead of
+// letting its backlog grow, and resyncs from the feed with the last seq it
+// acknowledged.
+class ChangeHub {
+public:
+    using SubscriberId = uint64_t;
+    using Sink = std::function<void(const std::string& message)>;
+    using Closer = std::function<void(const std::string& reason)>;
+
+    static constexpr size_t DEFAULT_RING_CAPACITY = 256;
+    static constexpr size_t MAX_PENDING_BYTES = 1024 * 1024;
+
+    struct Stats {
+        size_t subscribers = 0;
+        uint64_t published = 0;     // changes read from the feed
+        uint64_t delivered = 0;     // events handed to subscribers
+        uint64_t dropped = 0;       // subscribers closed as slow consumers
+    };
+
+    ChangeHub(std::shared_ptr<Database> db, size_t ring_capacity = DEFAULT_RING_CAPACITY);
+    ~ChangeHub();
+
+    ChangeHub(const ChangeHub&) = delete;
+    ChangeHub& operator=(const ChangeHub&) = delete;
+
+    // Sends {"type":"subscribed","user_id":N,"seq":S}, then every change to user_id's tasks
+    // after S; close is called once if the subscriber is dropped. Neither is called after
+    // unsubscribe() returns, and neither may call back into the hub (they run under the
+    // subscriber's lock, and the first send under the hub's).
+    SubscriberId subscribe(int user_id, Sink send, Closer close);
+    void unsubscribe(SubscriberId id);
+    // Releases the window slots of every event up to seq
+    void ack(SubscriberId id, sqlite3_int64 seq);
+
+    // Wakes the publisher after a write; cheap enough to call on every write
+    void notify();
+
+    Stats stats() const;
+
+private:
+    struct Sent {
+        sqlite3_int64 seq;
+        size_t bytes;
+    };
+
+    struct Subscriber {
+        SubscriberId id;
+        int user_id;
+        Sink send;
+        Closer close;
+
+        std::mutex mutex;
+        bool closed = false;
+        std::vector<Sent> ring;     // unacknowledged events
+        size_t head = 0;
+        size_t count = 0;
+        size_t pending_bytes = 0;
+    };
+
+    struct Change {
+        sqlite3_int64 seq;
+        int user_id;
+        std::string entry;
+    };
+
+    std::shared_ptr<Database> database;
+    size_t ring_capacity;
+
+    mutable std::shared_mutex subscribers_mutex;
+    std::unordered_map<SubscriberId, std::shared_ptr<Subscriber>> subscribers;
+    std::unordered_map<int, std::vector<std::shared_ptr<Subscriber>>> by_user;
+    SubscriberId next_id = 1;
+    sqlite3_int64 published_seq = 0;    // written by the publisher under subscribers_mutex, so
+                                        // the publisher alone may read it without the lock
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    bool pending = false;
+    bool stopping = false;
+
+    std::atomic<uint64_t> published{0};
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> dropped{0};
+
+    std::thread publisher;
+
+    void run();
+    bool publish_pending();
+    // False when the window was full and the subscriber has been closed
+    bool deliver(Subscriber& subscriber, sqlite3_int64 seq, const std::string& message);
+    void remove_locked(SubscriberId id);
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include "statement_cache.h"
+
+// Fixed-size pool of SQLite connections opened in WAL mode.
+// Each calling thread is pinned to one slot (by a process-wide thread ordinal),
+// so with pool size >= worker count every Crow worker owns its own connection.
+// If the pinned slot is busy, a free slot is borrowed before blocking.
+// Every connection keeps its own StatementCache, reached through the lease.
+class ConnectionPool {
+    struct Slot;
+
+public:
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        sqlite3* get() const;
+        explicit operator bool() const { return get() != nullptr; }
+
+        // Returns a cached statement for sql; it must not outlive the lease
+        Statement prepare(std::string_view sql);
+
+    private:
+        friend class ConnectionPool;
+        Lease(std::unique_lock<std::mutex> lock, Slot* slot);
+
+        void record_hold_time();
+
+        std::unique_lock<std::mutex> lock;
+        Slot* slot = nullptr;
+        std::chrono::steady_clock::time_point acquired_at;
+    };
+
+    ConnectionPool(const std::string& db_path, size_t size);
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    bool open();
+    void close();
+    Lease acquire();
+    size_t size() const { return slots.size(); }
+
+    // Opens a single connection with the pragmas every pooled connection uses.
+    static sqlite3* open_connection(const std::string& db_path);
+
+private:
+    struct Slot {
+        std::mutex mutex;
+        sqlite3* handle = nullptr;
+        StatementCache statements;
+    };
+
+    std::string db_path;
+    std::vector<std::unique_ptr<Slot>> slots;
+
+    static size_t thread_ordinal();
+};
@@ -3,37 +3,159 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <chrono>
+#include <optional>
+#include <functional>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
+#include "connection_pool.h"
+#include "row_cache.h"
+#include "write_queue.h"
+
+// Keyset pagination over the integer primary key plus optional column projection.
+struct PageQuery {
+    static constexpr int DEFAULT_LIMIT = 50;
+    static constexpr int MAX_LIMIT = 1000;
+
+    int after_id = 0;                   // return rows with id > after_id
+    int limit = DEFAULT_LIMIT;
+    std::vector<std::string> fields;    // empty selects every public column
+};
+
+// Full-text task search. text holds words and "quoted phrases" that must all match;
+// a trailing * makes a term a prefix query. Relevance order ranks every match by bm25
+// and pages by (rank, id); Recent order streams matches newest first, which stays fast
+// for terms that match most rows. Pass a page's next_cursor back as after.
+struct SearchQuery {
+    static constexpr size_t MAX_TEXT_LENGTH = 256;
+    static constexpr size_t MAX_TERMS = 16;
+
+    enum class Order { Relevance, Recent };
+
+    std::string text;
+    Order order = Order::Relevance;
+    std::optional<int> user_id;         // only this user's tasks
+    std::string after;                  // empty for the first page
+    int limit = PageQuery::DEFAULT_LIMIT;
+};
+
+// Change feed cursor: every task write gets a new, increasing sequence number
+struct ChangeQuery {
+    sqlite3_int64 since = 0;            // return changes with seq > since
+    std::optional<int> user_id;         // only this user's tasks
+    int limit = PageQuery::MAX_LIMIT;
+};
+
+// Task fields for create/update (single or batch). Absent fields keep their stored
+// value on update; description defaults to empty on create.
+struct TaskBatchItem {
+    int id = 0;
+    std::optional<std::string> title;
+    std::optional<std::string> description;
+    std::optional<bool> completed;
+};
+
+// Per-item outcome, using HTTP status codes (0 = not processed yet)
+struct TaskBatchResult {
+    int status = 0;
+    int id = 0;
+    std::string error;
+};
+
+// Result of an ownership-scoped single-row write
+enum class WriteOutcome {
+    Applied,
+    NotFound,
+    Forbidden,      // the row exists but belongs to another user
+    Failed
+};
 
 class Database {
 public:
-    Database(const std::string& db_path);
+    static constexpr size_t DEFAULT_CACHE_BYTES = 64 * 1024 * 1024;
+    // An export is one response built in memory, so it stops after this many bytes of
+    // rows and reports where the next export should start
+    static constexpr size_t MAX_EXPORT_BYTES = 16 * 1024 * 1024;
+    
+    // pool_size of 0 sizes the connection pool to the hardware thread count.
+    // cache_bytes caps the user/task point-lookup caches together.
+    // Writes go through a group-commit WriteQueue: write_batch caps operations per
+    // transaction and write_delay bounds how long a partial batch waits to fill.
+    Database(const std::string& db_path, size_t pool_size = 0, size_t cache_bytes = DEFAULT_CACHE_BYTES,
+             size_t write_batch = WriteQueue::DEFAULT_MAX_BATCH,
+             std::chrono::microseconds write_delay = std::chrono::microseconds(0));
     ~Database();
     
     bool initialize();
     bool execute(const std::string& sql);
+    nlohmann::json cache_stats();
+    WriteQueue::Stats write_stats() const { return writer->stats(); }
     
     // User operations
     bool create_user(const std::string& username, const std::string& email, const std::string& password_hash);
-    nlohmann::json get_user_by_id(int user_id);
     nlohmann::json get_user_by_username(const std::string& username);
-    std::vector<nlohmann::json> get_all_users();
+    // Paged reads throw std::invalid_argument for unknown projection fields
+    bool export_users(const PageQuery& query, std::string& out, std::optional<int>& next_cursor);
+    
+    // Serialized reads: append JSON text to out without building a DOM.
+    // Point lookups go through the row caches and return false when the row does not exist.
+    bool write_user_by_id(int user_id, std::string& out);
+    bool write_all_users(const PageQuery& query, std::string& out, std::optional<int>& next_cursor);
     bool update_user(int user_id, const std::string& username, const std::string& email);
+    bool update_password_hash(int user_id, const std::string& password_hash);
     bool delete_user(int user_id);
     
     // Task operations
     bool create_task(const std::string& title, const std::string& description, int user_id);
-    nlohmann::json get_task_by_id(int task_id);
-    std::vector<nlohmann::json> get_tasks_by_user(int user_id);
-    std::vector<nlohmann::json> get_all_tasks();
-    bool update_task(int task_id, const std::string& title, const std::string& description, bool completed);
-    bool delete_task(int task_id);
+    // Appends matching rows (limit is ignored) as a JSON array of at most MAX_EXPORT_BYTES;
+    // next_cursor is set when rows remain after that. False on a read error, in which
+    // case the array written so far is incomplete and must not be sent.
+    bool export_tasks(const PageQuery& query, std::optional<int> user_id, std::string& out, std::optional<int>& next_cursor);
+    bool write_task_by_id(int task_id, std::string& out, int* owner_id = nullptr);
+    bool write_tasks_by_user(int user_id, const PageQuery& query, std::string& out, std::optional<int>& next_cursor);
+    bool write_all_tasks(const PageQuery& query, std::string& out, std::optional<int>& next_cursor);
+    // Appends matching tasks with a highlighted "snippet" and their "rank"; throws
+    // std::invalid_argument for an empty or oversized query or a malformed cursor
+    bool search_tasks(const SearchQuery& query, std::string& out, std::optional<std::string>& next_cursor);
+    // Appends the latest change of each task written after query.since, oldest first:
+    // {"seq","id","deleted","task"} with task null for deletions. last_seq is the
+    // cursor to resume from (query.since when nothing changed).
+    bool write_task_changes(const ChangeQuery& query, std::string& out, sqlite3_int64& last_seq, bool& has_more);
+    // Same changes one at a time, with the owning user; entry is one element of the feed array
+    using ChangeVisitor = std::function<void(sqlite3_int64 seq, int user_id, const std::string& entry)>;
+    bool visit_task_changes(const ChangeQuery& query, const ChangeVisitor& visit, sqlite3_int64& last_seq, bool& has_more);
+    // Highest seq recorded so far (0 when there are none, -1 on error)
+    sqlite3_int64 latest_change_seq();
+    // Single-statement writes scoped to the owner (WHERE id = ? AND user_id = ?); the owner
+    // is only looked up separately when nothing matched, to tell NotFound from Forbidden.
+    // update_task applies only the fields present in changes and appends the updated row to out.
+    WriteOutcome update_task(int task_id, int user_id, const TaskBatchItem& changes, std::string& out);
+    WriteOutcome delete_task(int task_id, int user_id);
+    
+    // Batch writes: one savepoint, one ownership query and one reused statement per call.
+    // results must be sized like the input; entries with a non-zero status (rejected by
+    // the caller) are skipped. Returns false, with nothing applied, if the transaction fails.
+    static constexpr size_t MAX_BATCH_SIZE = 1000;
+    bool create_tasks(int user_id, const std::vector<TaskBatchItem>& items, std::vector<TaskBatchResult>& results);
+    bool update_tasks(int user_id, const std::vector<TaskBatchItem>& items, std::vector<TaskBatchResult>& results);
+    bool delete_tasks(int user_id, const std::vector<int>& task_ids, std::vector<TaskBatchResult>& results);
 
 private:
-    sqlite3* db;
+    std::unique_ptr<ConnectionPool> pool;
+    std::unique_ptr<WriteQueue> writer;
+    std::unique_ptr<RowCache> user_cache;
+    std::unique_ptr<RowCache> task_cache;
     std::string db_path;
     
     bool create_tables();
-    nlohmann::json row_to_json_user(sqlite3_stmt* stmt);
-    nlohmann::json row_to_json_task(sqlite3_stmt* stmt);
+    bool export_rows(const std::string& sql, const PageQuery& query, std::optional<int> user_id,
+                     std::string& out, std::optional<int>& next_cursor);
+    bool write_page(const std::string& sql, const PageQuery& query, std::optional<int> user_id,
+                    std::string& out, std::optional<int>& next_cursor);
+    WriteOutcome probe_task_owner(WriteQueue::Context& ctx, int task_id, int user_id);
+    // Owner of each existing task in task_ids; false when the lookup itself fails
+    bool load_task_owners(WriteQueue::Context& ctx, const std::vector<int>& task_ids, std::unordered_map<int, int>& owners);
+    bool write_cached_row(RowCache& cache, const char* sql, int id, int owner_column, std::string& out, int* owner_id);
+    static std::string build_page_sql(const char* table, const std::vector<const char*>& columns,
+                                       const PageQuery& query, bool filter_by_user);
 };
@@ -0,0 +1,26 @@
+#pragma once
+#include <functional>
+#include <optional>
+#include <string_view>
+
+// Allocation-free replacements for the std::regex checks on the request path.
+class InputValidator {
+public:
+    // Matches "Bearer\s+(.+)": returns a view of the token inside header, which must outlive it
+    static std::optional<std::string_view> parse_bearer_token(std::string_view header);
+    
+    // Matches [a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,}
+    static bool is_valid_email(std::string_view email);
+    
+    // Visits each element of an Accept or Accept-Encoding list ("gzip;q=0.8, br") with
+    // its value trimmed (case kept) and its q-value, 1 when absent and 0 when malformed
+    static void parse_quality_list(std::string_view header, const std::function<void(std::string_view value, double q)>& visit);
+    
+    // ASCII case-insensitive comparison, for header tokens
+    static bool equals_ignore_case(std::string_view a, std::string_view b);
+    
+    // Length of the well-formed UTF-8 sequence at the start of text (RFC 3629: no overlong
+    // forms, surrogates or code points past U+10FFFF); 0 when it is not one
+    static size_t utf8_sequence_length(std::string_view text);
+    static bool is_valid_utf8(std::string_view text);
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+// Serializes result rows to JSON text straight from sqlite3_column_* values,
+// without building an nlohmann::json object per row. Key fragments ("name":)
+// are computed once per statement; column "completed" is written as a boolean
+// to match the DOM path.
+class JsonRowWriter {
+public:
+    // Columns before first_column are left out (for callers that write them separately)
+    explicit JsonRowWriter(sqlite3_stmt* stmt, int first_column = 0);
+
+    // Appends the current row of stmt to out as a JSON object
+    void write_row(sqlite3_stmt* stmt, std::string& out) const;
+
+    // Appends text as a quoted JSON string; well-formed UTF-8 is copied through and each
+    // byte of a malformed sequence is replaced with U+FFFD, so the output is always valid JSON
+    static void append_string(std::string& out, const char* text, size_t length);
+    static void append_string(std::string& out, const std::string& text) {
+        append_string(out, text.data(), text.size());
+    }
+
+private:
+    struct Column {
+        std::string key;    // ,"name": (the first column has no leading comma)
+        int index;
+        bool is_boolean;
+    };
+
+    std::vector<Column> columns;
+};
@@ -0,0 +1,109 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Log-linear latency histogram in nanoseconds (16 sub-buckets per power of two,
+// so quantiles are within ~6%). Each instance has a single writer thread;
+// readers merge copies, so recording is a relaxed load and store, no RMW.
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKETS = 16;
+    static constexpr size_t BUCKETS = SUB_BUCKETS + 37 * SUB_BUCKETS;   // up to ~2^41 ns
+
+    void record(uint64_t nanos);
+    void merge_into(std::vector<uint64_t>& buckets, uint64_t& count, uint64_t& sum_nanos) const;
+
+    // Quantile (0..1) over merged buckets, in nanoseconds (bucket midpoint)
+    static double quantile(const std::vector<uint64_t>& buckets, uint64_t count, double q);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum_nanos{0};
+
+    static size_t bucket_index(uint64_t nanos);
+    static double bucket_midpoint(size_t index);
+};
+
+// Process-wide request metrics. Every recording thread owns a shard (created on
+// first use), so the hot path never touches shared cache lines; a scrape merges
+// all shards and renders Prometheus text format.
+class Metrics {
+public:
+    enum class Stage { Database, Auth, Serialize, Count };
+
+    static constexpr size_t MAX_ROUTES = 64;
+    static constexpr size_t NO_ROUTE = MAX_ROUTES;
+
+    static Metrics& global();
+
+    // Registers a route label such as "GET /api/tasks/<int>" at setup; returns its id
+    size_t register_route(const std::string& label);
+    void record_request(size_t route, int status, std::chrono::steady_clock::duration elapsed);
+    void record_stage(Stage stage, std::chrono::steady_clock::duration elapsed);
+
+    // Extra series computed at scrape time (type is "gauge" or "counter")
+    void add_series(const std::string& name, const std::string& help, const std::string& type,
+                    std::function<double()> value);
+    // Same, with a label set such as class="read"; register a name's series one after another
+    void add_series(const std::string& name, const std::string& labels, const std::string& help,
+                    const std::string& type, std::function<double()> value);
+
+    std::string render_prometheus();
+
+    // Adds the elapsed time of its scope to a stage
+    class StageTimer {
+    public:
+        explicit StageTimer(Stage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+        ~StageTimer() { Metrics::global().record_stage(stage, std::chrono::steady_clock::now() - start); }
+        StageTimer(const StageTimer&) = delete;
+        StageTimer& operator=(const StageTimer&) = delete;
+
+    private:
+        Stage stage;
+        std::chrono::steady_clock::time_point start;
+    };
+
+private:
+    // Status codes the API returns get their own counter; anything else is "other"
+    static constexpr std::array<int, 15> TRACKED_STATUSES = {
+        200, 201, 204, 304, 400, 401, 403, 404, 405, 409, 413, 429, 500, 503, 0
+    };
+
+    struct RouteCounters {
+        std::array<std::atomic<uint64_t>, TRACKED_STATUSES.size()> statuses{};
+        LatencyHistogram latency;
+    };
+
+    struct Shard {
+        // Allocated by the owning thread on first request for the route
+        std::array<std::atomic<RouteCounters*>, MAX_ROUTES> routes{};
+        std::array<LatencyHistogram, static_cast<size_t>(Stage::Count)> stages;
+        ~Shard();
+    };
+
+    struct Series {
+        std::string name;
+        std::string labels;
+        std::string help;
+        std::string type;
+        std::function<double()> value;
+    };
+
+    Metrics() = default;
+    Shard& local_shard();
+    static size_t status_index(int status);
+
+    std::mutex mutex;           // guards route labels and series
+    std::mutex shards_mutex;    // taken once per thread (first record) and while merging
+    std::vector<std::string> route_labels;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<Series> series;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Dedicated worker pool for key derivation. Callers wait on the returned future,
+// so each admitted job holds an HTTP worker until its hash is done. Admission is
+// bounded: once max_pending jobs are running or queued, submit() refuses new
+// work and the caller answers 503. ServerConfig keeps max_pending below the
+// handler thread count, so a burst of logins cannot occupy every HTTP worker.
+class PasswordHasher {
+public:
+    struct Stats {
+        uint64_t completed = 0;
+        uint64_t rejected = 0;
+        size_t pending = 0;
+        size_t threads = 0;
+    };
+
+    // thread_count 0 = half the hardware threads; max_pending (running + queued jobs) 0 = thread_count
+    PasswordHasher(size_t thread_count = 0, size_t max_pending = 0);
+    ~PasswordHasher();
+
+    PasswordHasher(const PasswordHasher&) = delete;
+    PasswordHasher& operator=(const PasswordHasher&) = delete;
+
+    // Returns nullopt when the queue is full
+    template <typename Fn>
+    std::optional<std::future<std::invoke_result_t<Fn>>> submit(Fn&& fn) {
+        using Result = std::invoke_result_t<Fn>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        auto future = task->get_future();
+        if (!enqueue([task]() { (*task)(); })) {
+            return std::nullopt;
+        }
+        return future;
+    }
+
+    Stats stats() const;
+
+private:
+    bool enqueue(std::function<void()> job);
+    void worker_loop();
+
+    size_t max_pending;
+    std::vector<std::thread> workers;
+    mutable std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::function<void()>> jobs;
+    size_t running = 0;
+    bool stopping = false;
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> rejected{0};
+};
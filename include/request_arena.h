@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Per-thread monotonic scratch memory for the duration of one request. A
+// Scope opened around a handler makes ArenaAllocator hand out memory by
+// bumping a pointer in the worker's arena; nothing is freed individually, and
+// the whole arena is rewound when the outermost Scope ends. The arena keeps
+// its largest footprint (up to MAX_RETAINED_BYTES) in one block, so a
+// worker's steady-state requests do not touch the global heap for it at all.
+//
+// Memory from the arena must not outlive the Scope or leave the thread:
+// RequestJson values are for request-local DOMs (parsed bodies, error and
+// success envelopes), never for anything cached or queued.
+class RequestArena {
+public:
+    static constexpr size_t INITIAL_BLOCK_BYTES = 64 * 1024;
+    static constexpr size_t MAX_RETAINED_BYTES = 1024 * 1024;
+
+    struct Stats {
+        uint64_t blocks_allocated = 0;      // blocks taken from the global heap, by all threads
+        uint64_t bytes_allocated = 0;       // their total size
+    };
+
+    // Marks the current thread as serving a request; the arena is reset when the
+    // outermost Scope on the thread ends
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    ~RequestArena();
+
+    // The calling thread's arena
+    static RequestArena& current();
+
+    bool active() const { return depth > 0; }
+    void* allocate(size_t bytes, size_t alignment);
+    // True when p was handed out by this arena (and must not be passed to operator delete)
+    bool owns(const void* p) const;
+
+    static Stats stats();
+    // Bytes the calling thread's arena keeps between requests
+    static size_t retained_bytes();
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;      // the last one is being filled
+    size_t used = 0;                // bytes used in the last block
+    size_t depth = 0;               // open Scopes
+
+    RequestArena() = default;
+    void reset();
+    void add_block(size_t min_bytes);
+};
+
+// Allocates from the thread's RequestArena inside a Scope and from the global
+// heap outside one; stateless, as nlohmann::basic_json requires of its allocator
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        RequestArena& arena = RequestArena::current();
+        if (arena.active()) {
+            return static_cast<T*>(arena.allocate(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        // Arena memory is released all at once when the request ends
+        if (!RequestArena::current().owns(p)) {
+            ::operator delete(p);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>&) const noexcept { return false; }
+};
+
+// nlohmann::json with its objects, arrays and strings in the request arena.
+// Strings longer than the small-string buffer still use the global heap.
+using RequestJson = nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t,
+                                         std::uint64_t, double, ArenaAllocator>;
+
+// RequestJson::dump() without the serializer, indent string and output string
+// it allocates on every call: writes compact JSON into a buffer the calling
+// thread reuses. The result is valid until the thread's next call. This relies
+// on nlohmann's internal serializer on nlohmann_json 3.10-3.11 only; other
+// versions fall back to dump() (same output, more allocations).
+const std::string& dump_json(const RequestJson& value);
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Serialized response bodies keyed by request URL, each with a strong ETag.
+// Entries are tagged with the user whose tasks they contain so write routes
+// can drop everything that user's change could affect; an owner -> keys index
+// keeps that proportional to the owner's entries. Fills follow a generation
+// protocol like RowCache's, but per owner: a fill started at generation() is
+// discarded only if its owner was invalidated since, so one user's writes do
+// not throw away other users' fills.
+class ResponseCache {
+public:
+    struct Entry {
+        std::string etag;   // quoted, ready for the ETag header
+        std::string body;
+        int owner_id;
+        std::string content_encoding;   // empty = identity
+        std::string content_type;       // empty = application/json
+    };
+
+    explicit ResponseCache(size_t max_bytes);
+
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    std::shared_ptr<const Entry> get(const std::string& key) const;
+    uint64_t generation() const { return current_generation.load(std::memory_order_acquire); }
+    void put(const std::string& key, std::shared_ptr<const Entry> entry, uint64_t generation);
+    void invalidate_owner(int owner_id);
+
+    // Strong validator over the exact body bytes (64-bit FNV-1a)
+    static std::string make_etag(const std::string& body);
+    // True when an If-None-Match header value lists etag (or is "*")
+    static bool etag_matches(const std::string& if_none_match, const std::string& etag);
+
+private:
+    size_t max_bytes;
+    size_t bytes = 0;
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const Entry>> entries;
+    std::deque<std::string> insertion_order;    // FIFO eviction; stale keys are skipped
+    std::unordered_map<int, std::unordered_set<std::string>> owner_keys;
+    std::unordered_map<int, uint64_t> invalidated_at;   // owner -> generation of its last write
+    uint64_t invalidated_floor = 0;     // fills older than this are refused for every owner
+    std::atomic<uint64_t> current_generation{0};
+
+    static size_t entry_bytes(const std::string& key, const Entry& entry);
+    void erase_locked(std::unordered_map<std::string, std::shared_ptr<const Entry>>::iterator it);
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Content-Encoding for response bodies: gzip and deflate through zlib, and zstd
+// when the build found libzstd (HAVE_ZSTD). Each thread keeps its own
+// compressor contexts and output buffer, so a request allocates nothing beyond
+// its response body; a buffer grown past MAX_RETAINED_BYTES by an export is
+// released rather than kept. Bodies under min_bytes are sent as they are: the
+// headers and CPU would cost more than the bytes saved.
+class ResponseCompressor {
+public:
+    enum class Encoding { Identity, Gzip, Deflate, Zstd };
+
+    static constexpr size_t MAX_RETAINED_BYTES = 1024 * 1024;
+
+    struct Config {
+        bool enabled = true;
+        size_t min_bytes = 1024;
+        int level = 1;              // zlib level, 1 (fastest) to 9 (smallest); see compression_bench
+        int zstd_level = 3;         // 1 to 19
+    };
+
+    struct Stats {
+        uint64_t compressed = 0;    // responses sent compressed
+        uint64_t bytes_in = 0;      // their size before compression
+        uint64_t bytes_out = 0;     // and after
+    };
+
+    explicit ResponseCompressor(const Config& config);
+
+    ResponseCompressor(const ResponseCompressor&) = delete;
+    ResponseCompressor& operator=(const ResponseCompressor&) = delete;
+
+    // Best encoding an Accept-Encoding header allows (by q-value, then zstd, gzip,
+    // deflate); Identity when compression is off or nothing acceptable is supported
+    Encoding negotiate(const std::string& accept_encoding) const;
+
+    // Replaces body with its encoded form; false (body untouched) when it is under
+    // min_bytes, the encoding is Identity, or compression fails
+    bool compress(Encoding encoding, std::string& body);
+
+    static const char* encoding_name(Encoding encoding);
+    static bool zstd_available();
+    // Capacity of the calling thread's output buffer, kept between requests
+    static size_t retained_bytes();
+    Stats stats() const;
+
+private:
+    Config config;
+    std::atomic<uint64_t> compressed{0};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+
+    bool deflate_into(Encoding encoding, const std::string& in, std::string& out) const;
+    bool zstd_into(const std::string& in, std::string& out) const;
+};
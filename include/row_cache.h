@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Sharded read-through cache of serialized rows keyed by primary key.
+// Lookups take a shard's shared lock and only flip a CLOCK reference bit, so
+// concurrent readers never serialize; inserts and invalidations take the
+// shard's exclusive lock. Eviction runs CLOCK until the shard is under its
+// share of the byte budget.
+//
+// Fills are guarded by a per-shard generation: read generation() before
+// querying the database and pass it to put(); if the shard was invalidated in
+// between, the possibly stale row is dropped instead of cached.
+class RowCache {
+public:
+    struct Entry {
+        std::string json;   // serialized row, as written by JsonRowWriter
+        int owner_id;       // user that owns the row (the user itself for users)
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t invalidations = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit RowCache(size_t max_bytes, size_t shard_count = 16);
+
+    RowCache(const RowCache&) = delete;
+    RowCache& operator=(const RowCache&) = delete;
+
+    std::shared_ptr<const Entry> get(int id);
+    uint64_t generation(int id) const;
+    void put(int id, std::shared_ptr<const Entry> entry, uint64_t generation);
+    void invalidate(int id);
+    void invalidate_owner(int owner_id);
+    void clear();
+
+    Stats stats() const;
+
+private:
+    struct Slot {
+        std::shared_ptr<const Entry> entry;
+        size_t ring_index;
+        mutable std::atomic<bool> referenced{true};
+    };
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<int, Slot> slots;
+        std::vector<int> ring;      // keys in CLOCK order
+        size_t hand = 0;
+        size_t bytes = 0;
+        std::atomic<uint64_t> generation{0};
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> evictions{0};
+        std::atomic<uint64_t> invalidations{0};
+    };
+
+    size_t max_bytes_per_shard;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    Shard& shard_for(int id) const;
+    static size_t entry_bytes(const Entry& entry);
+    void erase_locked(Shard& shard, std::unordered_map<int, Slot>::iterator it);
+    void evict_locked(Shard& shard);
+};
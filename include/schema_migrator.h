@@ -0,0 +1,26 @@
+#pragma once
+#include <sqlite3.h>
+#include <vector>
+
+struct Migration {
+    int version;
+    const char* description;
+    const char* sql;
+};
+
+// Applies ordered migrations and records them in the schema_version table.
+// Each migration runs in its own IMMEDIATE transaction and the current version
+// is re-read inside it, so concurrent starters apply every migration once.
+class SchemaMigrator {
+public:
+    explicit SchemaMigrator(sqlite3* db) : db(db) {}
+
+    bool migrate(const std::vector<Migration>& migrations);
+    int current_version();
+
+private:
+    sqlite3* db;
+
+    bool exec(const char* sql);
+    bool apply(const Migration& migration);
+};
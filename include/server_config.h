@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "admission_controller.h"
+#include "change_hub.h"
+#include "response_compressor.h"
+#include "database.h"
+
+// Runtime settings for the server process. Values come from an optional JSON
+// config file (keys are the environment variable names in lower case, e.g.
+// {"io_threads": 32, "db_pool_size": 32, "cpu_affinity": "0-31"}), then from
+// the environment, which wins.
+struct ServerConfig {
+    static constexpr size_t DEFAULT_MAX_BODY_BYTES = 1024 * 1024;
+    // Crow takes its thread count as uint16_t; far below that, more threads only add contention
+    static constexpr size_t MAX_IO_THREADS = 1024;
+    // The acceptor, a handler that may hash a password and one that is always free for the rest
+    static constexpr size_t MIN_IO_THREADS = 3;
+
+    int port = 8080;
+    std::string db_path = "rest_api.db";
+
+    // Threads
+    size_t io_threads = 0;              // Crow workers; 0 = hardware threads, at least MIN_IO_THREADS
+    size_t db_pool_size = 0;            // pooled SQLite connections; 0 = hardware threads
+    size_t hash_threads = 0;            // password hashing pool; 0 = half the hardware threads, at most hash_queue
+    size_t hash_queue = 0;              // register/login requests hashing or queued at once; 0 = handler_threads() / 4, at least 1
+    std::vector<int> cpu_affinity;      // CPUs the process may run on; empty = no restriction
+    bool pin_workers = false;           // pin each worker thread to one CPU of cpu_affinity (all if empty)
+
+    // Connections and requests
+    int keep_alive_seconds = 5;         // idle keep-alive/read timeout (Crow's timeout, max 255)
+    size_t max_body_bytes = DEFAULT_MAX_BODY_BYTES;     // larger bodies get 413
+
+    // Storage and auth
+    size_t cache_bytes = Database::DEFAULT_CACHE_BYTES;
+    size_t write_batch = WriteQueue::DEFAULT_MAX_BATCH;
+    std::chrono::microseconds write_delay{0};
+    int pbkdf2_iterations = 0;          // 0 = AuthService default
+
+    // Responses
+    ResponseCompressor::Config compression;
+
+    // Push
+    size_t push_ring_capacity = ChangeHub::DEFAULT_RING_CAPACITY;   // unacknowledged events per subscriber
+
+    AdmissionController::Config admission;
+
+    // Reads path (if not empty) and then the environment; false on an unreadable or invalid file
+    static bool load(const std::string& path, ServerConfig& config);
+
+    // Threads Crow runs handlers on: io_threads (as load() defaults it when 0) less the one
+    // that accepts connections, and at least one
+    size_t handler_threads() const;
+
+    // Restricts the process to cpu_affinity; threads started afterwards inherit it
+    bool apply_cpu_affinity() const;
+
+    // Pins the calling thread to the next CPU of cpus, round robin
+    static bool pin_current_thread(const std::vector<int>& cpus);
+
+    // Parses a CPU list such as "0-15,32-47"; false on malformed input
+    static bool parse_cpu_list(const std::string& text, std::vector<int>& cpus);
+};
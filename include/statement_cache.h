@@ -0,0 +1,53 @@
+#pragma once
+#include <sqlite3.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// RAII handle to a cached prepared statement. The statement stays owned by its
+// StatementCache; on destruction it is reset and its bindings cleared so the
+// next user gets a clean statement and no read transaction is left open.
+// Statements that did not fit in the cache are owned and finalized instead.
+class Statement {
+public:
+    Statement() = default;
+    Statement(sqlite3_stmt* stmt, bool owned) : stmt(stmt), owned(owned) {}
+    Statement(Statement&& other) noexcept : stmt(other.stmt), owned(other.owned) { other.stmt = nullptr; }
+    Statement& operator=(Statement&& other) noexcept;
+    Statement(const Statement&) = delete;
+    Statement& operator=(const Statement&) = delete;
+    ~Statement() { release(); }
+
+    sqlite3_stmt* get() const { return stmt; }
+    explicit operator bool() const { return stmt != nullptr; }
+
+private:
+    sqlite3_stmt* stmt = nullptr;
+    bool owned = false;
+
+    void release();
+};
+
+// Per-connection cache of compiled statements keyed by SQL text.
+// Not thread-safe: callers must hold the owning connection exclusively.
+class StatementCache {
+public:
+    explicit StatementCache(size_t capacity = 128) : capacity(capacity) {}
+    ~StatementCache() { clear(); }
+
+    StatementCache(const StatementCache&) = delete;
+    StatementCache& operator=(const StatementCache&) = delete;
+
+    Statement prepare(sqlite3* db, std::string_view sql);
+    void clear();
+
+    size_t hits() const { return hit_count; }
+    size_t misses() const { return miss_count; }
+
+private:
+    size_t capacity;
+    std::unordered_map<std::string, sqlite3_stmt*> statements;
+    std::string lookup_key;  // reused so cache hits do not allocate
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+};
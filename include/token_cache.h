@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "auth_service.h"
+
+// Bounded cache of already-verified bearer tokens, so hot clients skip the
+// HMAC and payload decode. Keyed by a hash of the token; the full token is kept
+// and compared on hit, so a hash collision can never authenticate anything.
+// Entries respect exp, and revoke_user() rejects every token issued to that
+// user up to now (cached or not) until such tokens would have expired anyway.
+class TokenCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t rejected_revoked = 0;
+        size_t entries = 0;
+    };
+
+    TokenCache(size_t capacity, long long token_lifetime_seconds, size_t shard_count = 16);
+
+    TokenCache(const TokenCache&) = delete;
+    TokenCache& operator=(const TokenCache&) = delete;
+
+    // Verifies through the cache; falls back to AuthService::decode_jwt_token on a miss
+    std::optional<std::pair<int, std::string>> verify(std::string_view token);
+    void revoke_user(int user_id);
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::string token;
+        int user_id;
+        std::string username;
+        long long expires_at;
+        size_t ring_index;
+        mutable std::atomic<bool> referenced{true};
+    };
+
+    // Full shards evict with CLOCK (second chance), as RowCache does; an expired
+    // entry under the hand goes regardless of its reference bit
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<uint64_t, Entry> entries;
+        std::vector<uint64_t> ring;     // keys in CLOCK order
+        size_t hand = 0;
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+    };
+
+    size_t capacity_per_shard;
+    long long token_lifetime_seconds;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    mutable std::shared_mutex revocation_mutex;
+    std::unordered_map<int, long long> revoked_at;  // user_id -> revocation time (unix seconds)
+    std::atomic<uint64_t> rejected_revoked{0};
+
+    Shard& shard_for(uint64_t hash) const;
+    static void erase_locked(Shard& shard, std::unordered_map<uint64_t, Entry>::iterator it);
+    static void evict_one_locked(Shard& shard, long long now);
+    bool is_revoked_locked(const AuthService::TokenClaims& claims) const;
+    static long long now_seconds();
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include <sqlite3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "statement_cache.h"
+
+// Single-writer group commit. Handlers submit write operations from any thread;
+// one writer thread with its own connection drains up to max_batch queued
+// operations into a single BEGIN IMMEDIATE ... COMMIT and completes every
+// caller's future once the batch has committed. Each operation runs inside its
+// own SAVEPOINT, so a failing operation is rolled back alone and the rest of
+// the batch still commits.
+//
+// Batches form naturally while the previous commit is in flight; a non-zero
+// max_delay additionally holds a partial batch open for up to that long.
+class WriteQueue {
+public:
+    static constexpr size_t DEFAULT_MAX_BATCH = 128;
+
+    // Handed to operations on the writer thread
+    class Context {
+    public:
+        sqlite3* get() const { return db; }
+        Statement prepare(std::string_view sql) { return statements.prepare(db, sql); }
+        // Runs after the batch commits, and only if this operation succeeded
+        void after_commit(std::function<void()> action) { actions.push_back(std::move(action)); }
+
+    private:
+        friend class WriteQueue;
+        Context(sqlite3* db, StatementCache& statements) : db(db), statements(statements) {}
+
+        sqlite3* db;
+        StatementCache& statements;
+        std::vector<std::function<void()>> actions;
+    };
+
+    // Returns false (or throws) to roll back its own changes
+    using Operation = std::function<bool(Context& ctx)>;
+
+    struct Stats {
+        uint64_t batches = 0;
+        uint64_t operations = 0;
+        uint64_t failed = 0;
+        size_t largest_batch = 0;
+    };
+
+    WriteQueue(const std::string& db_path, size_t max_batch = DEFAULT_MAX_BATCH,
+               std::chrono::microseconds max_delay = std::chrono::microseconds(0));
+    ~WriteQueue();
+
+    WriteQueue(const WriteQueue&) = delete;
+    WriteQueue& operator=(const WriteQueue&) = delete;
+
+    bool start();
+    // Drains what is already queued, then joins the writer
+    void stop();
+
+    std::future<bool> submit(Operation op);
+    // Submits and waits for the commit. Never call from inside an operation.
+    bool run(Operation op);
+
+    Stats stats() const;
+
+private:
+    struct Pending {
+        Operation op;
+        std::promise<bool> done;
+    };
+
+    std::string db_path;
+    size_t max_batch;
+    std::chrono::microseconds max_delay;
+
+    sqlite3* db = nullptr;
+    StatementCache statements;
+    std::thread writer;
+
+    mutable std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Pending> queue;
+    bool running = false;
+
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> operations{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<size_t> largest_batch{0};
+
+    void writer_loop();
+    void commit_batch(std::vector<Pending>& batch);
+    bool step(const char* sql);
+};
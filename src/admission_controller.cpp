@@ -0,0 +1,165 @@
+#include "admission_controller.h"
+#include <algorithm>
+#include <thread>
+
+AdmissionController::Config AdmissionController::resolve(Config config) {
+    if (config.worker_threads == 0) {
+        // One of .multithreaded()'s hardware threads only accepts connections
+        config.worker_threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+
+    size_t available = config.worker_threads > RESERVED_THREADS ? config.worker_threads - RESERVED_THREADS : 1;
+    if (!config.max_queued) {
+        // A short queue absorbs bursts; whatever it takes comes out of the running slots
+        size_t queue = available / 4;
+        if (config.capacity > 0) {
+            queue = std::min(queue, available > config.capacity ? available - config.capacity : 0);
+        }
+        config.max_queued = queue;
+    }
+    if (config.capacity == 0) {
+        config.capacity = available > *config.max_queued ? available - *config.max_queued : 1;
+    }
+    return config;
+}
+
+AdmissionController::AdmissionController(const Config& unresolved)
+    : route_limits(unresolved.route_limits) {
+    Config config = resolve(unresolved);
+    total_capacity = config.capacity;
+    max_queued = *config.max_queued;
+    max_wait = config.max_wait;
+
+    class_limits[static_cast<size_t>(Priority::Read)] = total_capacity;
+    class_limits[static_cast<size_t>(Priority::Write)] = std::max<size_t>(1, total_capacity * 3 / 4);
+    class_limits[static_cast<size_t>(Priority::Bulk)] = std::max<size_t>(1, total_capacity / 4);
+
+    class_max_queued[static_cast<size_t>(Priority::Read)] = max_queued;
+    class_max_queued[static_cast<size_t>(Priority::Write)] = max_queued;
+    class_max_queued[static_cast<size_t>(Priority::Bulk)] = (max_queued + 1) / 2;
+}
+
+void AdmissionController::add_route(size_t route, const std::string& label, Priority priority) {
+    std::lock_guard<std::mutex> lock(mutex);
+    RouteState& state = routes[std::min(route, MAX_ROUTES)];
+    state.priority = priority;
+
+    auto limit = route_limits.find(label);
+    if (limit != route_limits.end()) {
+        state.limit = limit->second;
+    }
+}
+
+const char* AdmissionController::priority_name(Priority priority) {
+    switch (priority) {
+        case Priority::Critical: return "critical";
+        case Priority::Read: return "read";
+        case Priority::Write: return "write";
+        case Priority::Bulk: return "bulk";
+        default: return "unknown";
+    }
+}
+
+bool AdmissionController::can_run_locked(size_t route) const {
+    const RouteState& state = routes[route];
+    size_t index = static_cast<size_t>(state.priority);
+    return in_flight < total_capacity &&
+           classes[index].in_flight < class_limits[index] &&
+           (state.limit == 0 || state.in_flight < state.limit);
+}
+
+void AdmissionController::start_locked(size_t route) {
+    RouteState& state = routes[route];
+    ClassStats& stats = classes[static_cast<size_t>(state.priority)];
+    ++state.in_flight;
+    ++stats.in_flight;
+    ++stats.admitted;
+    if (state.priority != Priority::Critical) {
+        ++in_flight;
+    }
+}
+
+void AdmissionController::dispatch_locked() {
+    // Highest priority first, oldest first within a class; a waiter blocked by
+    // its class or route limit does not hold up the ones behind it
+    for (size_t index = static_cast<size_t>(Priority::Read); index < CLASS_COUNT; ++index) {
+        auto& queue = queues[index];
+        for (auto it = queue.begin(); it != queue.end() && in_flight < total_capacity;) {
+            Waiter* waiter = *it;
+            if (!can_run_locked(waiter->route)) {
+                ++it;
+                continue;
+            }
+            start_locked(waiter->route);
+            waiter->granted = true;
+            waiter->ready.notify_one();
+            it = queue.erase(it);
+            --classes[index].queued;
+            --queued;
+        }
+    }
+}
+
+std::optional<AdmissionController::Ticket> AdmissionController::admit(size_t route) {
+    route = std::min(route, MAX_ROUTES);
+    std::unique_lock<std::mutex> lock(mutex);
+    Priority priority = routes[route].priority;
+    size_t index = static_cast<size_t>(priority);
+
+    if (priority == Priority::Critical) {
+        start_locked(route);
+        return Ticket(this, route);
+    }
+
+    // Run now unless an earlier request of the same or a higher class is waiting
+    bool queue_ahead = false;
+    for (size_t i = static_cast<size_t>(Priority::Read); i <= index; ++i) {
+        queue_ahead = queue_ahead || !queues[i].empty();
+    }
+    if (!queue_ahead && can_run_locked(route)) {
+        start_locked(route);
+        return Ticket(this, route);
+    }
+
+    ClassStats& stats = classes[index];
+    if (queued >= max_queued || stats.queued >= class_max_queued[index]) {
+        ++stats.shed_queue_full;
+        return std::nullopt;
+    }
+
+    Waiter waiter;
+    waiter.route = route;
+    queues[index].push_back(&waiter);
+    ++stats.queued;
+    ++queued;
+    dispatch_locked();
+
+    auto deadline = std::chrono::steady_clock::now() + max_wait;
+    waiter.ready.wait_until(lock, deadline, [&waiter]() { return waiter.granted; });
+    if (waiter.granted) {
+        return Ticket(this, route);
+    }
+
+    auto& queue = queues[index];
+    queue.erase(std::find(queue.begin(), queue.end(), &waiter));
+    --stats.queued;
+    --queued;
+    ++stats.shed_deadline;
+    return std::nullopt;
+}
+
+void AdmissionController::release(size_t route) {
+    std::lock_guard<std::mutex> lock(mutex);
+    RouteState& state = routes[route];
+    --state.in_flight;
+    --classes[static_cast<size_t>(state.priority)].in_flight;
+    if (state.priority != Priority::Critical) {
+        --in_flight;
+        dispatch_locked();
+    }
+}
+
+AdmissionController::ClassStats AdmissionController::stats(Priority priority) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return classes[static_cast<size_t>(priority)];
+}
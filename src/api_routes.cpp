@@ -1,113 +1,309 @@
 #include "api_routes.h"
 #include "auth_service.h"
+#include "json_writer.h"
+#include "input_validator.h"
+#include "metrics.h"
 #include <iostream>
-#include <regex>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 
-APIRoutes::APIRoutes(std::shared_ptr<Database> db) : database(db) {}
+namespace {
+    const size_t RESPONSE_CACHE_BYTES = 32 * 1024 * 1024;
+    const size_t TOKEN_CACHE_ENTRIES = 100000;
+    const size_t MAX_PUSH_MESSAGE_BYTES = 4096;     // client messages are subscribe and ack only
+}
+
+APIRoutes::APIRoutes(std::shared_ptr<Database> db, const ServerConfig& config)
+    : database(db),
+      response_cache(RESPONSE_CACHE_BYTES),
+      token_cache(TOKEN_CACHE_ENTRIES, AuthService::token_lifetime_seconds()),
+      password_hasher(config.hash_threads, config.hash_queue),
+      admission(config.admission),
+      change_hub(db, config.push_ring_capacity),
+      compressor(config.compression),
+      max_body_bytes(config.max_body_bytes),
+      worker_cpus(config.pin_workers ? config.cpu_affinity : std::vector<int>()) {}
 
 void APIRoutes::setup_routes(crow::SimpleApp& app) {
+    register_metrics();
+    
     // Enable CORS
     CROW_ROUTE(app, "/").methods("OPTIONS"_method)
     ([](const crow::request& req) {
         crow::response res(200);
         res.add_header("Access-Control-Allow-Origin", "*");
-        res.add_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
+        res.add_header("Access-Control-Allow-Methods", "GET, POST, PUT, PATCH, DELETE, OPTIONS");
         res.add_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
         return res;
     });
 
     // Health check
     CROW_ROUTE(app, "/api/health")
-    ([this]() {
-        auto response = create_success_response("API is running");
-        crow::response res(200, response.dump());
-        res.add_header("Content-Type", "application/json");
-        res.add_header("Access-Control-Allow-Origin", "*");
-        return res;
+    ([this, route = route_id("GET /api/health")](const crow::request& req) {
+        return observe(route, req, [this]() {
+            auto response = create_success_response("API is running");
+            crow::response res(200, dump_json(response));
+            res.add_header("Content-Type", "application/json");
+            res.add_header("Access-Control-Allow-Origin", "*");
+            return res;
+        });
+    });
+    
+    // Point-lookup cache counters
+    CROW_ROUTE(app, "/api/cache/stats").methods("GET"_method)
+    ([this, route = route_id("GET /api/cache/stats")](const crow::request& req) {
+        return observe(route, req, [this]() {
+            auto stats = database->cache_stats();
+            auto tokens = token_cache.stats();
+            stats["tokens"] = {
+                {"hits", tokens.hits},
+                {"misses", tokens.misses},
+                {"rejected_revoked", tokens.rejected_revoked},
+                {"entries", tokens.entries}
+            };
+            
+            auto response = create_success_response("Cache statistics retrieved successfully", stats);
+            return json_response(200, dump_json(response));
+        });
+    });
+    
+    // Prometheus text exposition of the request metrics
+    CROW_ROUTE(app, "/api/metrics").methods("GET"_method)
+    ([this, route = route_id("GET /api/metrics")](const crow::request& req) {
+        return observe(route, req, []() {
+            crow::response res(200, Metrics::global().render_prometheus());
+            res.add_header("Content-Type", "text/plain; version=0.0.4");
+            return res;
+        });
     });
     
     // Auth routes
     CROW_ROUTE(app, "/api/auth/register").methods("POST"_method)
-    ([this](const crow::request& req) {
-        return register_user(req);
+    ([this, route = route_id("POST /api/auth/register")](const crow::request& req) {
+        return observe(route, req, [&]() { return register_user(req); });
     });
     
     CROW_ROUTE(app, "/api/auth/login").methods("POST"_method)
-    ([this](const crow::request& req) {
-        return login(req);
+    ([this, route = route_id("POST /api/auth/login")](const crow::request& req) {
+        return observe(route, req, [&]() { return login(req); });
     });
     
     // User routes
     CROW_ROUTE(app, "/api/users").methods("GET"_method)
-    ([this]() {
-        return get_users();
+    ([this, route = route_id("GET /api/users")](const crow::request& req) {
+        return observe(route, req, [&]() { return get_users(req); });
     });
     
     CROW_ROUTE(app, "/api/users/<int>").methods("GET"_method)
-    ([this](int user_id) {
-        return get_user(user_id);
+    ([this, route = route_id("GET /api/users/<int>")](const crow::request& req, int user_id) {
+        return observe(route, req, [&]() { return get_user(user_id); });
     });
     
     CROW_ROUTE(app, "/api/users/<int>").methods("PUT"_method)
-    ([this](const crow::request& req, int user_id) {
-        return update_user(req, user_id);
+    ([this, route = route_id("PUT /api/users/<int>")](const crow::request& req, int user_id) {
+        return observe(route, req, [&]() { return update_user(req, user_id); });
     });
     
     CROW_ROUTE(app, "/api/users/<int>").methods("DELETE"_method)
-    ([this](const crow::request& req, int user_id) {
-        return delete_user(req, user_id);
+    ([this, route = route_id("DELETE /api/users/<int>")](const crow::request& req, int user_id) {
+        return observe(route, req, [&]() { return delete_user(req, user_id); });
     });
     
     // Task routes
     CROW_ROUTE(app, "/api/tasks").methods("GET"_method)
-    ([this]() {
-        return get_tasks();
+    ([this, route = route_id("GET /api/tasks")](const crow::request& req) {
+        return observe(route, req, [&]() { return get_tasks(req); });
     });
     
     CROW_ROUTE(app, "/api/tasks").methods("POST"_method)
-    ([this](const crow::request& req) {
-        return create_task(req);
+    ([this, route = route_id("POST /api/tasks")](const crow::request& req) {
+        return observe(route, req, [&]() { return create_task(req); });
+    });
+    
+    CROW_ROUTE(app, "/api/tasks/batch").methods("POST"_method)
+    ([this, route = route_id("POST /api/tasks/batch")](const crow::request& req) {
+        return observe(route, req, [&]() { return create_tasks_batch(req); });
+    });
+    
+    CROW_ROUTE(app, "/api/tasks/batch").methods("PUT"_method)
+    ([this, route = route_id("PUT /api/tasks/batch")](const crow::request& req) {
+        return observe(route, req, [&]() { return update_tasks_batch(req); });
+    });
+    
+    CROW_ROUTE(app, "/api/tasks/batch").methods("DELETE"_method)
+    ([this, route = route_id("DELETE /api/tasks/batch")](const crow::request& req) {
+        return observe(route, req, [&]() { return delete_tasks_batch(req); });
+    });
+    
+    CROW_ROUTE(app, "/api/tasks/search").methods("GET"_method)
+    ([this, route = route_id("GET /api/tasks/search")](const crow::request& req) {
+        return observe(route, req, [&]() { return search_tasks(req); });
+    });
+    
+    CROW_ROUTE(app, "/api/tasks/changes").methods("GET"_method)
+    ([this, route = route_id("GET /api/tasks/changes")](const crow::request& req) {
+        return observe(route, req, [&]() { return get_task_changes(req); });
     });
     
     CROW_ROUTE(app, "/api/tasks/<int>").methods("GET"_method)
-    ([this](int task_id) {
-        return get_task(task_id);
+    ([this, route = route_id("GET /api/tasks/<int>")](const crow::request& req, int task_id) {
+        return observe(route, req, [&]() { return get_task(req, task_id); });
     });
     
-    CROW_ROUTE(app, "/api/tasks/<int>").methods("PUT"_method)
-    ([this](const crow::request& req, int task_id) {
-        return update_task(req, task_id);
+    CROW_ROUTE(app, "/api/tasks/<int>").methods("PUT"_method, "PATCH"_method)
+    ([this, put_route = route_id("PUT /api/tasks/<int>"), patch_route = route_id("PATCH /api/tasks/<int>")](const crow::request& req, int task_id) {
+        size_t route = req.method == crow::HTTPMethod::Patch ? patch_route : put_route;
+        return observe(route, req, [&]() { return update_task(req, task_id); });
     });
     
     CROW_ROUTE(app, "/api/tasks/<int>").methods("DELETE"_method)
-    ([this](const crow::request& req, int task_id) {
-        return delete_task(req, task_id);
+    ([this, route = route_id("DELETE /api/tasks/<int>")](const crow::request& req, int task_id) {
+        return observe(route, req, [&]() { return delete_task(req, task_id); });
     });
     
     CROW_ROUTE(app, "/api/users/<int>/tasks").methods("GET"_method)
-    ([this](int user_id) {
-        return get_user_tasks(user_id);
+    ([this, route = route_id("GET /api/users/<int>/tasks")](const crow::request& req, int user_id) {
+        return observe(route, req, [&]() { return get_user_tasks(req, user_id); });
+    });
+    
+    // Push channel for task changes; long-lived, so it bypasses admission control
+    CROW_WEBSOCKET_ROUTE(app, "/api/ws")
+    .onmessage([this](crow::websocket::connection& conn, const std::string& data, bool is_binary) {
+        if (is_binary || data.size() > MAX_PUSH_MESSAGE_BYTES) {
+            conn.send_text(push_error("Expected a JSON text message"));
+            conn.close("unsupported message");
+            return;
+        }
+        handle_push_message(conn, data);
+    })
+    .onclose([this](crow::websocket::connection& conn, const std::string&, auto...) {
+        // Crow 1.1 adds a close code argument
+        close_push_connection(conn);
     });
 }
 
-nlohmann::json APIRoutes::create_error_response(const std::string& message, int code) {
-    return nlohmann::json{
-        {"success", false},
-        {"error", {
-            {"message", message},
-            {"code", code}
-        }}
-    };
+size_t APIRoutes::route_id(const char* label) {
+    size_t route = Metrics::global().register_route(label);
+    admission.add_route(route, label, route_priority(label));
+    return route;
+}
+
+AdmissionController::Priority APIRoutes::route_priority(const std::string& label) {
+    // Probes are never queued; reads go ahead of writes, and bulk writes come last
+    if (label == "GET /api/health" || label == "GET /api/metrics") {
+        return AdmissionController::Priority::Critical;
+    }
+    if (label.find("/batch") != std::string::npos) {
+        return AdmissionController::Priority::Bulk;
+    }
+    if (label.compare(0, 4, "GET ") == 0) {
+        return AdmissionController::Priority::Read;
+    }
+    return AdmissionController::Priority::Write;
 }
 
-nlohmann::json APIRoutes::create_success_response(const std::string& message, const nlohmann::json& data) {
-    nlohmann::json response = {
-        {"success", true},
-        {"message", message}
+crow::response APIRoutes::observe(size_t route, const std::function<crow::response()>& handler) {
+    // Crow gives no hook when it starts a worker, so workers pin themselves on first use
+    thread_local bool pinned = false;
+    if (!pinned && !worker_cpus.empty()) {
+        pinned = ServerConfig::pin_current_thread(worker_cpus);
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    auto ticket = admission.admit(route);
+    crow::response res;
+    {
+        // Request-local DOMs live in the worker's arena until the response is built
+        RequestArena::Scope scratch;
+        res = ticket ? handler() : busy_response();
+    }
+    Metrics::global().record_request(route, res.code, std::chrono::steady_clock::now() - start);
+    return res;
+}
+
+crow::response APIRoutes::observe(size_t route, const crow::request& req, const std::function<crow::response()>& handler) {
+    if (req.body.size() <= max_body_bytes) {
+        return observe(route, [&]() { return encoded(req, handler()); });
+    }
+    
+    auto error = create_error_response("Request body too large", 413);
+    crow::response res(413, dump_json(error));
+    res.add_header("Content-Type", "application/json");
+    Metrics::global().record_request(route, res.code, std::chrono::steady_clock::duration::zero());
+    return res;
+}
+
+void APIRoutes::register_metrics() {
+    auto& metrics = Metrics::global();
+    metrics.add_series("api_password_hash_pending", "Register/login requests waiting for a hashing thread.", "gauge",
+                       [this]() { return static_cast<double>(password_hasher.stats().pending); });
+    metrics.add_series("api_password_hash_rejected_total", "Register/login requests shed because the hashing queue was full.", "counter",
+                       [this]() { return static_cast<double>(password_hasher.stats().rejected); });
+    metrics.add_series("api_write_batches_total", "Group-commit transactions.", "counter",
+                       [this]() { return static_cast<double>(database->write_stats().batches); });
+    metrics.add_series("api_write_operations_total", "Writes committed through the write queue.", "counter",
+                       [this]() { return static_cast<double>(database->write_stats().operations); });
+    metrics.add_series("api_token_cache_hits_total", "Bearer tokens accepted without re-verifying the signature.", "counter",
+                       [this]() { return static_cast<double>(token_cache.stats().hits); });
+    metrics.add_series("api_compressed_responses_total", "Responses sent with a Content-Encoding.", "counter",
+                       [this]() { return static_cast<double>(compressor.stats().compressed); });
+    metrics.add_series("api_compression_bytes_in_total", "Body bytes of compressed responses before compression.", "counter",
+                       [this]() { return static_cast<double>(compressor.stats().bytes_in); });
+    metrics.add_series("api_compression_bytes_out_total", "Body bytes of compressed responses as sent.", "counter",
+                       [this]() { return static_cast<double>(compressor.stats().bytes_out); });
+    metrics.add_series("api_request_arena_blocks_total", "Request arena blocks taken from the global heap; flat once every worker is warm.", "counter",
+                       []() { return static_cast<double>(RequestArena::stats().blocks_allocated); });
+    metrics.add_series("api_push_subscribers", "WebSocket clients subscribed to task changes.", "gauge",
+                       [this]() { return static_cast<double>(change_hub.stats().subscribers); });
+    metrics.add_series("api_push_events_total", "Task change events pushed to subscribers.", "counter",
+                       [this]() { return static_cast<double>(change_hub.stats().delivered); });
+    metrics.add_series("api_push_dropped_total", "Subscribers closed as slow consumers.", "counter",
+                       [this]() { return static_cast<double>(change_hub.stats().dropped); });
+    
+    using Priority = AdmissionController::Priority;
+    const Priority classes[] = {Priority::Critical, Priority::Read, Priority::Write, Priority::Bulk};
+    auto per_class = [&](const char* name, const char* help, const char* type,
+                         std::function<double(const AdmissionController::ClassStats&)> value) {
+        for (Priority priority : classes) {
+            metrics.add_series(name, std::string("class=\"") + AdmissionController::priority_name(priority) + "\"", help, type,
+                               [this, priority, value]() { return value(admission.stats(priority)); });
+        }
     };
+    per_class("api_admission_in_flight", "Requests running their handler, by admission class.", "gauge",
+              [](const AdmissionController::ClassStats& stats) { return static_cast<double>(stats.in_flight); });
+    per_class("api_admission_queued", "Requests waiting for an admission slot.", "gauge",
+              [](const AdmissionController::ClassStats& stats) { return static_cast<double>(stats.queued); });
+    per_class("api_admission_shed_queue_full_total", "Requests shed with 503 because the admission queue was full.", "counter",
+              [](const AdmissionController::ClassStats& stats) { return static_cast<double>(stats.shed_queue_full); });
+    per_class("api_admission_shed_deadline_total", "Requests shed with 503 after waiting the maximum queue time.", "counter",
+              [](const AdmissionController::ClassStats& stats) { return static_cast<double>(stats.shed_deadline); });
+}
+
+RequestJson APIRoutes::parse_body(const crow::request& req) {
+    Metrics::StageTimer timer(Metrics::Stage::Serialize);
+    return BodyFormat::parse<RequestJson>(BodyFormat::from_content_type(req.get_header_value("Content-Type")), req.body);
+}
+
+// Envelopes are filled in by assignment rather than brace-initialized: nlohmann frees each
+// temporary of an initializer list through a heap-allocated stack, outside the arena
+RequestJson APIRoutes::create_error_response(const std::string& message, int code) {
+    RequestJson response;
+    response["success"] = false;
+    RequestJson& error = response["error"];
+    error["message"] = message;
+    error["code"] = code;
+    return response;
+}
+
+RequestJson APIRoutes::create_success_response(const std::string& message, RequestJson data) {
+    RequestJson response;
+    response["success"] = true;
+    response["message"] = message;
     
     if (!data.empty()) {
-        response["data"] = data;
+        response["data"] = std::move(data);
     }
     
     return response;
@@ -120,150 +316,409 @@ std::optional<std::pair<int, std::string>> APIRoutes::authenticate_request(const
     }
     
     // Check for Bearer token
-    std::regex bearer_regex("Bearer\\s+(.+)");
-    std::smatch matches;
-    
-    if (!std::regex_match(auth_header, matches, bearer_regex) || matches.size() != 2) {
+    auto token = InputValidator::parse_bearer_token(auth_header);
+    if (!token) {
         return std::nullopt;
     }
     
-    std::string token = matches[1].str();
-    return AuthService::verify_jwt_token(token);
+    Metrics::StageTimer timer(Metrics::Stage::Auth);
+    return token_cache.verify(*token);
+}
+
+PageQuery APIRoutes::parse_page_query(const crow::request& req) {
+    PageQuery query;
+    
+    if (const char* limit = req.url_params.get("limit")) {
+        query.limit = parse_limit(limit);
+    }
+    
+    if (const char* after = req.url_params.get("after")) {
+        char* end = nullptr;
+        long value = std::strtol(after, &end, 10);
+        if (end == after || *end != '\0' || value < 0 || value > INT32_MAX) {
+            throw std::invalid_argument("after must be a non-negative id");
+        }
+        query.after_id = static_cast<int>(value);
+    }
+    
+    if (const char* fields = req.url_params.get("fields")) {
+        std::string field;
+        for (const char* p = fields; ; ++p) {
+            if (*p == ',' || *p == '\0') {
+                if (!field.empty()) {
+                    query.fields.push_back(field);
+                    field.clear();
+                }
+                if (*p == '\0') {
+                    break;
+                }
+            } else {
+                field += *p;
+            }
+        }
+    }
+    
+    return query;
+}
+
+int APIRoutes::parse_limit(const char* limit) {
+    char* end = nullptr;
+    long value = std::strtol(limit, &end, 10);
+    if (end == limit || *end != '\0' || value < 1 || value > PageQuery::MAX_LIMIT) {
+        throw std::invalid_argument("limit must be between 1 and " + std::to_string(PageQuery::MAX_LIMIT));
+    }
+    return static_cast<int>(value);
+}
+
+std::string& APIRoutes::response_buffer() {
+    // Keeps its capacity between requests handled by the same worker thread
+    thread_local std::string buffer;
+    buffer.clear();
+    return buffer;
+}
+
+void APIRoutes::begin_success_body(std::string& out, const std::string& message) {
+    out += "{\"success\":true,\"message\":";
+    JsonRowWriter::append_string(out, message);
+}
+
+crow::response APIRoutes::json_response(int code, const std::string& body) {
+    crow::response res(code, body);
+    res.add_header("Content-Type", "application/json");
+    res.add_header("Access-Control-Allow-Origin", "*");
+    return res;
+}
+
+crow::response APIRoutes::busy_response() {
+    // Admission control or the hashing queue is full; shed the request rather than block another worker on it
+    auto error = create_error_response("Server is busy, please retry");
+    crow::response res(503, dump_json(error));
+    res.add_header("Content-Type", "application/json");
+    res.add_header("Retry-After", "1");
+    return res;
+}
+
+crow::response APIRoutes::page_response(const std::string& message, const PageQuery& query, const PageWriter& writer) {
+    auto& body = response_buffer();
+    begin_success_body(body, message);
+    body += ",\"data\":";
+    
+    std::optional<int> next_cursor;
+    if (!writer(body, next_cursor)) {
+        auto error = create_error_response("Internal server error");
+        return crow::response(500, dump_json(error));
+    }
+    
+    body += ",\"pagination\":{\"limit\":";
+    body += std::to_string(query.limit);
+    body += ",\"next_cursor\":";
+    body += next_cursor ? std::to_string(*next_cursor) : "null";
+    body += "}}";
+    
+    return json_response(200, body);
+}
+
+crow::response APIRoutes::row_response(const std::string& message, const std::string& not_found_message, const RowWriter& writer) {
+    auto& body = response_buffer();
+    begin_success_body(body, message);
+    body += ",\"data\":";
+    
+    if (!writer(body)) {
+        auto error = create_error_response(not_found_message);
+        return crow::response(404, dump_json(error));
+    }
+    
+    body += '}';
+    return json_response(200, body);
+}
+
+crow::response APIRoutes::cached_response(const crow::request& req, const std::function<crow::response(int& owner_id)>& build) {
+    const std::string& if_none_match = req.get_header_value("If-None-Match");
+    
+    // Each format and encoding is its own representation, cached with its own ETag
+    auto format = BodyFormat::from_accept(req.get_header_value("Accept"));
+    auto encoding = compressor.negotiate(req.get_header_value("Accept-Encoding"));
+    std::string key = req.raw_url;
+    if (format != BodyFormat::Format::Json) {
+        key += '\n';
+        key += BodyFormat::name(format);
+    }
+    if (encoding != ResponseCompressor::Encoding::Identity) {
+        key += '\n';
+        key += ResponseCompressor::encoding_name(encoding);
+    }
+    
+    std::shared_ptr<const ResponseCache::Entry> entry = response_cache.get(key);
+    crow::response res;
+    if (entry) {
+        res = json_response(200, entry->body);
+    } else {
+        uint64_t generation = response_cache.generation();
+        int owner_id = -1;
+        res = build(owner_id);
+        if (res.code != 200 || owner_id < 0) {
+            return res;
+        }
+        
+        // Stored encoded, so hits skip the transcoder and compressor too
+        std::string content_type;
+        if (format != BodyFormat::Format::Json && transcode_body(format, res.body)) {
+            content_type = BodyFormat::content_type(format);
+        }
+        std::string content_encoding;
+        if (compress_body(encoding, res.body)) {
+            content_encoding = ResponseCompressor::encoding_name(encoding);
+        }
+        entry = std::make_shared<ResponseCache::Entry>(ResponseCache::Entry{ResponseCache::make_etag(res.body), res.body, owner_id, content_encoding, content_type});
+        response_cache.put(key, entry, generation);
+    }
+    
+    if (!entry->content_type.empty()) {
+        res.set_header("Content-Type", entry->content_type);
+    }
+    if (!entry->content_encoding.empty()) {
+        res.add_header("Content-Encoding", entry->content_encoding);
+    }
+    res.add_header("Vary", "Accept, Accept-Encoding");
+    res.add_header("ETag", entry->etag);
+    res.add_header("Cache-Control", "no-cache");
+    if (!if_none_match.empty() && ResponseCache::etag_matches(if_none_match, entry->etag)) {
+        res.code = 304;
+        res.body.clear();
+    }
+    return res;
+}
+
+bool APIRoutes::wants_export(const crow::request& req) {
+    const char* value = req.url_params.get("export");
+    return value && (std::strcmp(value, "true") == 0 || std::strcmp(value, "1") == 0);
+}
+
+crow::response APIRoutes::export_response(const std::string& message, const PageWriter& writer) {
+    // Rows are serialized straight into the body, not the per-thread response buffer, so an
+    // export does not leave a buffer of MAX_EXPORT_BYTES behind on every worker
+    crow::response res = json_response(200, "");
+    begin_success_body(res.body, message);
+    res.body += ",\"data\":";
+    
+    std::optional<int> next_cursor;
+    if (!writer(res.body, next_cursor)) {
+        std::cerr << "Export failed: " << message << std::endl;
+        auto error = create_error_response("Internal server error");
+        return crow::response(500, dump_json(error));
+    }
+    
+    res.body += ",\"pagination\":{\"next_cursor\":";
+    res.body += next_cursor ? std::to_string(*next_cursor) : "null";
+    res.body += "}}";
+    return res;
+}
+
+crow::response APIRoutes::encoded(const crow::request& req, crow::response res, bool transcode) {
+    // Already negotiated (cached_response, or an export that opted out of transcoding)
+    if (!res.get_header_value("Vary").empty()) {
+        return res;
+    }
+    res.add_header("Vary", "Accept, Accept-Encoding");
+    
+    // Only successful JSON bodies change format; errors stay JSON for every client
+    if (transcode && res.code >= 200 && res.code < 300 && res.get_header_value("Content-Type") == "application/json") {
+        auto format = BodyFormat::from_accept(req.get_header_value("Accept"));
+        if (format != BodyFormat::Format::Json && transcode_body(format, res.body)) {
+            res.set_header("Content-Type", BodyFormat::content_type(format));
+        }
+    }
+    
+    auto encoding = compressor.negotiate(req.get_header_value("Accept-Encoding"));
+    if (compress_body(encoding, res.body)) {
+        res.add_header("Content-Encoding", ResponseCompressor::encoding_name(encoding));
+    }
+    return res;
+}
+
+bool APIRoutes::transcode_body(BodyFormat::Format format, std::string& body) {
+    Metrics::StageTimer timer(Metrics::Stage::Serialize);
+    return BodyFormat::transcode(format, body);
+}
+
+bool APIRoutes::compress_body(ResponseCompressor::Encoding encoding, std::string& body) {
+    if (encoding == ResponseCompressor::Encoding::Identity) {
+        return false;
+    }
+    Metrics::StageTimer timer(Metrics::Stage::Serialize);
+    return compressor.compress(encoding, body);
 }
 
 crow::response APIRoutes::register_user(const crow::request& req) {
     try {
-        auto json_data = nlohmann::json::parse(req.body);
+        auto json_data = parse_body(req);
         
         if (!json_data.contains("username") || !json_data.contains("email") || !json_data.contains("password")) {
             auto error = create_error_response("Missing required fields: username, email, password");
-            return crow::response(400, error.dump());
+            return crow::response(400, dump_json(error));
         }
         
-        std::string username = json_data["username"];
-        std::string email = json_data["email"];
-        std::string password = json_data["password"];
+        const auto& username = json_data["username"].get_ref<const std::string&>();
+        const auto& email = json_data["email"].get_ref<const std::string&>();
+        const auto& password = json_data["password"].get_ref<const std::string&>();
         
         // Validate email format
-        std::regex email_regex(R"([a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,})");
-        if (!std::regex_match(email, email_regex)) {
+        if (!InputValidator::is_valid_email(email)) {
             auto error = create_error_response("Invalid email format");
-            return crow::response(400, error.dump());
+            return crow::response(400, dump_json(error));
         }
         
         // Check if user already exists
         auto existing_user = database->get_user_by_username(username);
         if (!existing_user.empty()) {
             auto error = create_error_response("Username already exists");
-            return crow::response(409, error.dump());
+            return crow::response(409, dump_json(error));
+        }
+        
+        // Hash password on the hashing pool and create user
+        auto pending_hash = password_hasher.submit([password]() {
+            return AuthService::hash_password(password);
+        });
+        if (!pending_hash) {
+            return busy_response();
+        }
+        
+        std::string password_hash;
+        {
+            Metrics::StageTimer timer(Metrics::Stage::Auth);
+            password_hash = pending_hash->get();
+        }
+        if (password_hash.empty()) {
+            auto error = create_error_response("Failed to create user");
+            return crow::response(500, dump_json(error));
         }
         
-        // Hash password and create user
-        std::string password_hash = AuthService::hash_password(password);
         bool success = database->create_user(username, email, password_hash);
         
         if (success) {
             auto response = create_success_response("User registered successfully");
-            crow::response res(201, response.dump());
+            crow::response res(201, dump_json(response));
             res.add_header("Content-Type", "application/json");
             return res;
         } else {
             auto error = create_error_response("Failed to create user");
-            return crow::response(500, error.dump());
+            return crow::response(500, dump_json(error));
         }
         
     } catch (const nlohmann::json::exception& e) {
         auto error = create_error_response("Invalid JSON format");
-        return crow::response(400, error.dump());
+        return crow::response(400, dump_json(error));
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
     }
 }
 
 crow::response APIRoutes::login(const crow::request& req) {
     try {
-        auto json_data = nlohmann::json::parse(req.body);
+        auto json_data = parse_body(req);
         
         if (!json_data.contains("username") || !json_data.contains("password")) {
             auto error = create_error_response("Missing username or password");
-            return crow::response(400, error.dump());
+            return crow::response(400, dump_json(error));
         }
         
-        std::string username = json_data["username"];
-        std::string password = json_data["password"];
+        const auto& username = json_data["username"].get_ref<const std::string&>();
+        const auto& password = json_data["password"].get_ref<const std::string&>();
         
         auto user = database->get_user_by_username(username);
         if (user.empty()) {
             auto error = create_error_response("Invalid credentials");
-            return crow::response(401, error.dump());
+            return crow::response(401, dump_json(error));
         }
         
+        // Verify (and upgrade outdated hashes) on the hashing pool
+        struct Verification {
+            bool valid = false;
+            std::string upgraded_hash;
+        };
         std::string stored_hash = user["password_hash"];
-        if (!AuthService::verify_password(password, stored_hash)) {
+        auto pending = password_hasher.submit([password, stored_hash]() {
+            Verification result;
+            result.valid = AuthService::verify_password(password, stored_hash);
+            if (result.valid && AuthService::needs_rehash(stored_hash)) {
+                result.upgraded_hash = AuthService::hash_password(password);
+            }
+            return result;
+        });
+        if (!pending) {
+            return busy_response();
+        }
+        
+        Verification verification;
+        {
+            Metrics::StageTimer timer(Metrics::Stage::Auth);
+            verification = pending->get();
+        }
+        if (!verification.valid) {
             auto error = create_error_response("Invalid credentials");
-            return crow::response(401, error.dump());
+            return crow::response(401, dump_json(error));
         }
         
-        // Generate JWT token
         int user_id = user["id"];
+        if (!verification.upgraded_hash.empty() && !database->update_password_hash(user_id, verification.upgraded_hash)) {
+            std::cerr << "Failed to upgrade password hash for user " << user_id << std::endl;
+        }
+        
+        // Generate JWT token
         std::string token = AuthService::generate_jwt_token(user_id, username);
         
-        nlohmann::json user_data = {
-            {"id", user["id"]},
-            {"username", user["username"]},
-            {"email", user["email"]},
-            {"token", token}
-        };
+        RequestJson user_data;
+        user_data["id"] = user["id"];
+        user_data["username"] = user["username"];
+        user_data["email"] = user["email"];
+        user_data["token"] = token;
         
-        auto response = create_success_response("Login successful", user_data);
-        crow::response res(200, response.dump());
+        auto response = create_success_response("Login successful", std::move(user_data));
+        crow::response res(200, dump_json(response));
         res.add_header("Content-Type", "application/json");
         return res;
         
     } catch (const nlohmann::json::exception& e) {
         auto error = create_error_response("Invalid JSON format");
-        return crow::response(400, error.dump());
+        return crow::response(400, dump_json(error));
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
     }
 }
 
-crow::response APIRoutes::get_users() {
+crow::response APIRoutes::get_users(const crow::request& req) {
     try {
-        auto users = database->get_all_users();
-        auto response = create_success_response("Users retrieved successfully", users);
+        auto query = parse_page_query(req);
+        if (wants_export(req)) {
+            return encoded(req, export_response("Users exported successfully", [this, &query](std::string& out, std::optional<int>& next_cursor) {
+                return database->export_users(query, out, next_cursor);
+            }), false);
+        }
         
-        crow::response res(200, response.dump());
-        res.add_header("Content-Type", "application/json");
-        res.add_header("Access-Control-Allow-Origin", "*");
-        return res;
+        return page_response("Users retrieved successfully", query, [this, &query](std::string& out, std::optional<int>& next_cursor) {
+            return database->write_all_users(query, out, next_cursor);
+        });
         
+    } catch (const std::invalid_argument& e) {
+        auto error = create_error_response(e.what());
+        return crow::response(400, dump_json(error));
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
     }
 }
 
 crow::response APIRoutes::get_user(int user_id) {
     try {
-        auto user = database->get_user_by_id(user_id);
-        if (user.empty()) {
-            auto error = create_error_response("User not found");
-            return crow::response(404, error.dump());
-        }
-        
-        auto response = create_success_response("User retrieved successfully", user);
-        
-        crow::response res(200, response.dump());
-        res.add_header("Content-Type", "application/json");
-        res.add_header("Access-Control-Allow-Origin", "*");
-        return res;
+        return row_response("User retrieved successfully", "User not found", [this, user_id](std::string& out) {
+            return database->write_user_by_id(user_id, out);
+        });
         
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
     }
 }
 
@@ -272,43 +727,43 @@ crow::response APIRoutes::update_user(const crow::request& req, int user_id) {
     auto auth_result = authenticate_request(req);
     if (!auth_result.has_value()) {
         auto error = create_error_response("Authentication required");
-        return crow::response(401, error.dump());
+        return crow::response(401, dump_json(error));
     }
     
     int authenticated_user_id = auth_result->first;
     if (authenticated_user_id != user_id) {
         auto error = create_error_response("Unauthorized to update this user");
-        return crow::response(403, error.dump());
+        return crow::response(403, dump_json(error));
     }
     
     try {
-        auto json_data = nlohmann::json::parse(req.body);
+        auto json_data = parse_body(req);
         
         if (!json_data.contains("username") || !json_data.contains("email")) {
             auto error = create_error_response("Missing required fields: username, email");
-            return crow::response(400, error.dump());
+            return crow::response(400, dump_json(error));
         }
         
-        std::string username = json_data["username"];
-        std::string email = json_data["email"];
+        const auto& username = json_data["username"].get_ref<const std::string&>();
+        const auto& email = json_data["email"].get_ref<const std::string&>();
         
         bool success = database->update_user(user_id, username, email);
         if (success) {
             auto response = create_success_response("User updated successfully");
-            crow::response res(200, response.dump());
+            crow::response res(200, dump_json(response));
             res.add_header("Content-Type", "application/json");
             return res;
         } else {
             auto error = create_error_response("Failed to update user");
-            return crow::response(500, error.dump());
+            return crow::response(500, dump_json(error));
         }
         
     } catch (const nlohmann::json::exception& e) {
         auto error = create_error_response("Invalid JSON format");
-        return crow::response(400, error.dump());
+        return crow::response(400, dump_json(error));
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
     }
 }
 
@@ -317,108 +772,315 @@ crow::response APIRoutes::delete_user(const crow::request& req, int user_id) {
     auto auth_result = authenticate_request(req);
     if (!auth_result.has_value()) {
         auto error = create_error_response("Authentication required");
-        return crow::response(401, error.dump());
+        return crow::response(401, dump_json(error));
     }
     
     int authenticated_user_id = auth_result->first;
     if (authenticated_user_id != user_id) {
         auto error = create_error_response("Unauthorized to delete this user");
-        return crow::response(403, error.dump());
+        return crow::response(403, dump_json(error));
     }
     
     try {
         bool success = database->delete_user(user_id);
+        response_cache.invalidate_owner(user_id);
+        change_hub.notify();
         if (success) {
+            // Outstanding tokens for the deleted account stop authenticating immediately
+            token_cache.revoke_user(user_id);
+            
             auto response = create_success_response("User deleted successfully");
-            crow::response res(200, response.dump());
+            crow::response res(200, dump_json(response));
             res.add_header("Content-Type", "application/json");
             return res;
         } else {
             auto error = create_error_response("Failed to delete user");
-            return crow::response(500, error.dump());
+            return crow::response(500, dump_json(error));
         }
         
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
     }
 }
 
-crow::response APIRoutes::get_tasks() {
+crow::response APIRoutes::get_tasks(const crow::request& req) {
     try {
-        auto tasks = database->get_all_tasks();
-        auto response = create_success_response("Tasks retrieved successfully", tasks);
+        auto query = parse_page_query(req);
+        if (wants_export(req)) {
+            return encoded(req, export_response("Tasks exported successfully", [this, &query](std::string& out, std::optional<int>& next_cursor) {
+                return database->export_tasks(query, std::nullopt, out, next_cursor);
+            }), false);
+        }
         
-        crow::response res(200, response.dump());
-        res.add_header("Content-Type", "application/json");
-        res.add_header("Access-Control-Allow-Origin", "*");
-        return res;
+        return page_response("Tasks retrieved successfully", query, [this, &query](std::string& out, std::optional<int>& next_cursor) {
+            return database->write_all_tasks(query, out, next_cursor);
+        });
+        
+    } catch (const std::invalid_argument& e) {
+        auto error = create_error_response(e.what());
+        return crow::response(400, dump_json(error));
+    } catch (const std::exception& e) {
+        auto error = create_error_response("Internal server error");
+        return crow::response(500, dump_json(error));
+    }
+}
+
+crow::response APIRoutes::search_tasks(const crow::request& req) {
+    try {
+        SearchQuery query;
+        const char* text = req.url_params.get("q");
+        if (!text) {
+            auto error = create_error_response("Missing required parameter: q");
+            return crow::response(400, dump_json(error));
+        }
+        query.text = text;
+        
+        if (const char* limit = req.url_params.get("limit")) {
+            query.limit = parse_limit(limit);
+        }
+        if (const char* after = req.url_params.get("after")) {
+            query.after = after;
+        }
+        if (const char* sort = req.url_params.get("sort")) {
+            if (std::strcmp(sort, "recent") == 0) {
+                query.order = SearchQuery::Order::Recent;
+            } else if (std::strcmp(sort, "relevance") != 0) {
+                throw std::invalid_argument("sort must be relevance or recent");
+            }
+        }
+        if (const char* user = req.url_params.get("user_id")) {
+            char* end = nullptr;
+            long value = std::strtol(user, &end, 10);
+            if (end == user || *end != '\0' || value < 1 || value > INT32_MAX) {
+                throw std::invalid_argument("user_id must be a positive id");
+            }
+            query.user_id = static_cast<int>(value);
+        }
+        
+        auto& body = response_buffer();
+        begin_success_body(body, "Search completed successfully");
+        body += ",\"data\":";
+        
+        std::optional<std::string> next_cursor;
+        if (!database->search_tasks(query, body, next_cursor)) {
+            auto error = create_error_response("Internal server error");
+            return crow::response(500, dump_json(error));
+        }
+        
+        body += ",\"pagination\":{\"limit\":";
+        body += std::to_string(query.limit);
+        body += ",\"next_cursor\":";
+        if (next_cursor) {
+            JsonRowWriter::append_string(body, *next_cursor);
+        } else {
+            body += "null";
+        }
+        body += "}}";
+        
+        return json_response(200, body);
         
+    } catch (const std::invalid_argument& e) {
+        auto error = create_error_response(e.what());
+        return crow::response(400, dump_json(error));
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
+    }
+}
+
+crow::response APIRoutes::get_task_changes(const crow::request& req) {
+    try {
+        ChangeQuery query;
+        if (const char* since = req.url_params.get("since")) {
+            char* end = nullptr;
+            long long value = std::strtoll(since, &end, 10);
+            if (end == since || *end != '\0' || value < 0) {
+                throw std::invalid_argument("since must be a non-negative sequence number");
+            }
+            query.since = value;
+        }
+        if (const char* limit = req.url_params.get("limit")) {
+            query.limit = parse_limit(limit);
+        }
+        if (const char* user = req.url_params.get("user_id")) {
+            char* end = nullptr;
+            long value = std::strtol(user, &end, 10);
+            if (end == user || *end != '\0' || value < 1 || value > INT32_MAX) {
+                throw std::invalid_argument("user_id must be a positive id");
+            }
+            query.user_id = static_cast<int>(value);
+        }
+        
+        auto& body = response_buffer();
+        begin_success_body(body, "Changes retrieved successfully");
+        body += ",\"data\":";
+        
+        sqlite3_int64 last_seq = 0;
+        bool has_more = false;
+        if (!database->write_task_changes(query, body, last_seq, has_more)) {
+            auto error = create_error_response("Internal server error");
+            return crow::response(500, dump_json(error));
+        }
+        
+        // next_cursor is always set: it is the since value for the next page or the next sync
+        body += ",\"pagination\":{\"limit\":";
+        body += std::to_string(query.limit);
+        body += ",\"next_cursor\":";
+        body += std::to_string(last_seq);
+        body += ",\"has_more\":";
+        body += has_more ? "true" : "false";
+        body += "}}";
+        
+        return json_response(200, body);
+        
+    } catch (const std::invalid_argument& e) {
+        auto error = create_error_response(e.what());
+        return crow::response(400, dump_json(error));
+    } catch (const std::exception& e) {
+        auto error = create_error_response("Internal server error");
+        return crow::response(500, dump_json(error));
+    }
+}
+
+void APIRoutes::handle_push_message(crow::websocket::connection& conn, const std::string& data) {
+    RequestArena::Scope scratch;
+    RequestJson message;
+    try {
+        message = RequestJson::parse(data);
+    } catch (const nlohmann::json::exception& e) {
+        conn.send_text(push_error("Invalid JSON format"));
+        return;
+    }
+    
+    std::string type;
+    if (message.is_object() && message.contains("type") && message["type"].is_string()) {
+        type = message["type"].get<std::string>();
+    }
+    if (type == "ack") {
+        auto seq = message.find("seq");
+        if (seq == message.end() || !seq->is_number_integer()) {
+            conn.send_text(push_error("ack needs an integer seq"));
+            return;
+        }
+        
+        std::lock_guard<std::mutex> lock(push_mutex);
+        auto subscriber = push_subscribers.find(&conn);
+        if (subscriber == push_subscribers.end()) {
+            conn.send_text(push_error("Not subscribed"));
+            return;
+        }
+        change_hub.ack(subscriber->second, seq->get<sqlite3_int64>());
+        return;
+    }
+    
+    if (type != "subscribe") {
+        conn.send_text(push_error("Unknown message type"));
+        return;
+    }
+    
+    // Browsers can't set headers on a WebSocket handshake, so the bearer token comes in the message
+    auto token = message.find("token");
+    auto claims = token != message.end() && token->is_string()
+        ? token_cache.verify(token->get_ref<const std::string&>())
+        : std::nullopt;
+    if (!claims) {
+        conn.send_text(push_error("Authentication required"));
+        conn.close("authentication required");
+        return;
+    }
+    
+    int user_id = claims->first;
+    auto requested = message.find("user_id");
+    if (requested != message.end()) {
+        if (!requested->is_number_integer() || requested->get<long long>() < 1 || requested->get<long long>() > INT32_MAX) {
+            conn.send_text(push_error("user_id must be a positive id"));
+            return;
+        }
+        user_id = requested->get<int>();
+    }
+    
+    std::lock_guard<std::mutex> lock(push_mutex);
+    if (push_subscribers.count(&conn)) {
+        conn.send_text(push_error("Already subscribed"));
+        return;
+    }
+    
+    // Crow queues sends on the connection's own thread, so the hub never blocks on a socket;
+    // onclose unsubscribes before the connection is destroyed
+    crow::websocket::connection* target = &conn;
+    push_subscribers[target] = change_hub.subscribe(user_id,
+        [target](const std::string& event) { target->send_text(event); },
+        [target](const std::string& reason) { target->close(reason); });
+}
+
+void APIRoutes::close_push_connection(crow::websocket::connection& conn) {
+    std::lock_guard<std::mutex> lock(push_mutex);
+    auto subscriber = push_subscribers.find(&conn);
+    if (subscriber != push_subscribers.end()) {
+        change_hub.unsubscribe(subscriber->second);
+        push_subscribers.erase(subscriber);
     }
 }
 
+std::string APIRoutes::push_error(const std::string& message) {
+    return nlohmann::json{{"type", "error"}, {"message", message}}.dump();
+}
+
 crow::response APIRoutes::create_task(const crow::request& req) {
     // Authentication required
     auto auth_result = authenticate_request(req);
     if (!auth_result.has_value()) {
         auto error = create_error_response("Authentication required");
-        return crow::response(401, error.dump());
+        return crow::response(401, dump_json(error));
     }
     
     int user_id = auth_result->first;
     
     try {
-        auto json_data = nlohmann::json::parse(req.body);
+        auto json_data = parse_body(req);
         
         if (!json_data.contains("title")) {
             auto error = create_error_response("Missing required field: title");
-            return crow::response(400, error.dump());
+            return crow::response(400, dump_json(error));
         }
         
-        std::string title = json_data["title"];
+        const auto& title = json_data["title"].get_ref<const std::string&>();
         std::string description = json_data.value("description", "");
         
         bool success = database->create_task(title, description, user_id);
+        response_cache.invalidate_owner(user_id);
+        change_hub.notify();
         if (success) {
             auto response = create_success_response("Task created successfully");
-            crow::response res(201, response.dump());
+            crow::response res(201, dump_json(response));
             res.add_header("Content-Type", "application/json");
             return res;
         } else {
             auto error = create_error_response("Failed to create task");
-            return crow::response(500, error.dump());
+            return crow::response(500, dump_json(error));
         }
         
     } catch (const nlohmann::json::exception& e) {
         auto error = create_error_response("Invalid JSON format");
-        return crow::response(400, error.dump());
+        return crow::response(400, dump_json(error));
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
     }
 }
 
-crow::response APIRoutes::get_task(int task_id) {
+crow::response APIRoutes::get_task(const crow::request& req, int task_id) {
     try {
-        auto task = database->get_task_by_id(task_id);
-        if (task.empty()) {
-            auto error = create_error_response("Task not found");
-            return crow::response(404, error.dump());
-        }
-        
-        auto response = create_success_response("Task retrieved successfully", task);
-        
-        crow::response res(200, response.dump());
-        res.add_header("Content-Type", "application/json");
-        res.add_header("Access-Control-Allow-Origin", "*");
-        return res;
+        return cached_response(req, [this, task_id](int& owner_id) {
+            return row_response("Task retrieved successfully", "Task not found", [this, task_id, &owner_id](std::string& out) {
+                return database->write_task_by_id(task_id, out, &owner_id);
+            });
+        });
         
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
     }
 }
 
@@ -427,48 +1089,50 @@ crow::response APIRoutes::update_task(const crow::request& req, int task_id) {
     auto auth_result = authenticate_request(req);
     if (!auth_result.has_value()) {
         auto error = create_error_response("Authentication required");
-        return crow::response(401, error.dump());
+        return crow::response(401, dump_json(error));
     }
     
     try {
-        // Check if task exists and belongs to user
-        auto existing_task = database->get_task_by_id(task_id);
-        if (existing_task.empty()) {
-            auto error = create_error_response("Task not found");
-            return crow::response(404, error.dump());
+        auto json_data = parse_body(req);
+        
+        // Only the fields present in the body change (PUT and PATCH alike)
+        TaskBatchItem changes;
+        std::string invalid;
+        if (!parse_batch_item(json_data, false, changes, invalid)) {
+            auto error = create_error_response(invalid);
+            return crow::response(400, dump_json(error));
         }
         
-        int task_user_id = existing_task["user_id"];
         int authenticated_user_id = auth_result->first;
+        auto& body = response_buffer();
+        begin_success_body(body, "Task updated successfully");
+        body += ",\"data\":";
         
-        if (task_user_id != authenticated_user_id) {
+        WriteOutcome outcome = database->update_task(task_id, authenticated_user_id, changes, body);
+        if (outcome == WriteOutcome::NotFound) {
+            auto error = create_error_response("Task not found");
+            return crow::response(404, dump_json(error));
+        }
+        if (outcome == WriteOutcome::Forbidden) {
             auto error = create_error_response("Unauthorized to update this task");
-            return crow::response(403, error.dump());
+            return crow::response(403, dump_json(error));
         }
-        
-        auto json_data = nlohmann::json::parse(req.body);
-        
-        std::string title = json_data.value("title", existing_task["title"]);
-        std::string description = json_data.value("description", existing_task["description"]);
-        bool completed = json_data.value("completed", existing_task["completed"]);
-        
-        bool success = database->update_task(task_id, title, description, completed);
-        if (success) {
-            auto response = create_success_response("Task updated successfully");
-            crow::response res(200, response.dump());
-            res.add_header("Content-Type", "application/json");
-            return res;
-        } else {
+        if (outcome != WriteOutcome::Applied) {
             auto error = create_error_response("Failed to update task");
-            return crow::response(500, error.dump());
+            return crow::response(500, dump_json(error));
         }
         
+        response_cache.invalidate_owner(authenticated_user_id);
+        change_hub.notify();
+        body += '}';
+        return json_response(200, body);
+        
     } catch (const nlohmann::json::exception& e) {
         auto error = create_error_response("Invalid JSON format");
-        return crow::response(400, error.dump());
+        return crow::response(400, dump_json(error));
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
     }
 }
 
@@ -477,54 +1141,275 @@ crow::response APIRoutes::delete_task(const crow::request& req, int task_id) {
     auto auth_result = authenticate_request(req);
     if (!auth_result.has_value()) {
         auto error = create_error_response("Authentication required");
-        return crow::response(401, error.dump());
+        return crow::response(401, dump_json(error));
     }
     
     try {
-        // Check if task exists and belongs to user
-        auto existing_task = database->get_task_by_id(task_id);
-        if (existing_task.empty()) {
+        int authenticated_user_id = auth_result->first;
+        
+        WriteOutcome outcome = database->delete_task(task_id, authenticated_user_id);
+        if (outcome == WriteOutcome::NotFound) {
             auto error = create_error_response("Task not found");
-            return crow::response(404, error.dump());
+            return crow::response(404, dump_json(error));
+        }
+        if (outcome == WriteOutcome::Forbidden) {
+            auto error = create_error_response("Unauthorized to delete this task");
+            return crow::response(403, dump_json(error));
+        }
+        if (outcome != WriteOutcome::Applied) {
+            auto error = create_error_response("Failed to delete task");
+            return crow::response(500, dump_json(error));
         }
         
-        int task_user_id = existing_task["user_id"];
-        int authenticated_user_id = auth_result->first;
+        response_cache.invalidate_owner(authenticated_user_id);
+        change_hub.notify();
+        auto response = create_success_response("Task deleted successfully");
+        crow::response res(200, dump_json(response));
+        res.add_header("Content-Type", "application/json");
+        return res;
         
-        if (task_user_id != authenticated_user_id) {
-            auto error = create_error_response("Unauthorized to delete this task");
-            return crow::response(403, error.dump());
+    } catch (const std::exception& e) {
+        auto error = create_error_response("Internal server error");
+        return crow::response(500, dump_json(error));
+    }
+}
+
+crow::response APIRoutes::get_user_tasks(const crow::request& req, int user_id) {
+    try {
+        auto query = parse_page_query(req);
+        if (wants_export(req)) {
+            return encoded(req, export_response("User tasks exported successfully", [this, &query, user_id](std::string& out, std::optional<int>& next_cursor) {
+                return database->export_tasks(query, user_id, out, next_cursor);
+            }), false);
         }
         
-        bool success = database->delete_task(task_id);
-        if (success) {
-            auto response = create_success_response("Task deleted successfully");
-            crow::response res(200, response.dump());
-            res.add_header("Content-Type", "application/json");
-            return res;
+        return cached_response(req, [this, &query, user_id](int& owner_id) {
+            owner_id = user_id;
+            return page_response("User tasks retrieved successfully", query, [this, &query, user_id](std::string& out, std::optional<int>& next_cursor) {
+                return database->write_tasks_by_user(user_id, query, out, next_cursor);
+            });
+        });
+        
+    } catch (const std::invalid_argument& e) {
+        auto error = create_error_response(e.what());
+        return crow::response(400, dump_json(error));
+    } catch (const std::exception& e) {
+        auto error = create_error_response("Internal server error");
+        return crow::response(500, dump_json(error));
+    }
+}
+
+const RequestJson& APIRoutes::batch_items(const RequestJson& body, const char* key) {
+    if (!body.is_object() || !body.contains(key) || !body[key].is_array()) {
+        throw std::invalid_argument(std::string("Missing required field: ") + key + " (array)");
+    }
+    
+    const auto& items = body[key];
+    if (items.empty() || items.size() > Database::MAX_BATCH_SIZE) {
+        throw std::invalid_argument("Batch must contain between 1 and " + std::to_string(Database::MAX_BATCH_SIZE) + " items");
+    }
+    return items;
+}
+
+bool APIRoutes::parse_batch_item(const RequestJson& element, bool requires_id, TaskBatchItem& item, std::string& error) {
+    if (!element.is_object()) {
+        error = "Task must be a JSON object";
+        return false;
+    }
+    
+    if (requires_id) {
+        auto id = element.find("id");
+        if (id == element.end() || !id->is_number_integer()) {
+            error = "Missing required field: id";
+            return false;
+        }
+        item.id = id->get<int>();
+    }
+    
+    auto title = element.find("title");
+    if (title != element.end()) {
+        if (!title->is_string()) {
+            error = "Field title must be a string";
+            return false;
+        }
+        item.title = title->get<std::string>();
+    }
+    
+    auto description = element.find("description");
+    if (description != element.end()) {
+        if (!description->is_string()) {
+            error = "Field description must be a string";
+            return false;
+        }
+        item.description = description->get<std::string>();
+    }
+    
+    auto completed = element.find("completed");
+    if (completed != element.end()) {
+        if (!completed->is_boolean()) {
+            error = "Field completed must be a boolean";
+            return false;
+        }
+        item.completed = completed->get<bool>();
+    }
+    return true;
+}
+
+crow::response APIRoutes::batch_response(const std::string& message, const std::vector<TaskBatchResult>& results) {
+    Metrics::StageTimer timer(Metrics::Stage::Serialize);
+    RequestJson items = RequestJson::array();
+    size_t succeeded = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        RequestJson& item = items.emplace_back();
+        item["index"] = i;
+        item["status"] = result.status;
+        if (result.id != 0) {
+            item["id"] = result.id;
+        }
+        if (result.status < 300) {
+            ++succeeded;
         } else {
-            auto error = create_error_response("Failed to delete task");
-            return crow::response(500, error.dump());
+            item["error"] = result.error;
+        }
+    }
+    
+    RequestJson data;
+    data["results"] = std::move(items);
+    data["succeeded"] = succeeded;
+    data["failed"] = results.size() - succeeded;
+    return json_response(200, dump_json(create_success_response(message, std::move(data))));
+}
+
+crow::response APIRoutes::create_tasks_batch(const crow::request& req) {
+    // Authentication required
+    auto auth_result = authenticate_request(req);
+    if (!auth_result.has_value()) {
+        auto error = create_error_response("Authentication required");
+        return crow::response(401, dump_json(error));
+    }
+    
+    int user_id = auth_result->first;
+    
+    try {
+        auto json_data = parse_body(req);
+        const auto& elements = batch_items(json_data, "tasks");
+        
+        std::vector<TaskBatchItem> items(elements.size());
+        std::vector<TaskBatchResult> results(elements.size());
+        for (size_t i = 0; i < elements.size(); ++i) {
+            std::string error;
+            if (!parse_batch_item(elements[i], false, items[i], error)) {
+                results[i] = {400, 0, error};
+            }
+        }
+        
+        bool success = database->create_tasks(user_id, items, results);
+        response_cache.invalidate_owner(user_id);
+        change_hub.notify();
+        if (!success) {
+            auto error = create_error_response("Failed to create tasks");
+            return crow::response(500, dump_json(error));
         }
+        return batch_response("Tasks processed", results);
         
+    } catch (const nlohmann::json::exception& e) {
+        auto error = create_error_response("Invalid JSON format");
+        return crow::response(400, dump_json(error));
+    } catch (const std::invalid_argument& e) {
+        auto error = create_error_response(e.what());
+        return crow::response(400, dump_json(error));
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
     }
 }
 
-crow::response APIRoutes::get_user_tasks(int user_id) {
+crow::response APIRoutes::update_tasks_batch(const crow::request& req) {
+    // Authentication required
+    auto auth_result = authenticate_request(req);
+    if (!auth_result.has_value()) {
+        auto error = create_error_response("Authentication required");
+        return crow::response(401, dump_json(error));
+    }
+    
+    int user_id = auth_result->first;
+    
     try {
-        auto tasks = database->get_tasks_by_user(user_id);
-        auto response = create_success_response("User tasks retrieved successfully", tasks);
+        auto json_data = parse_body(req);
+        const auto& elements = batch_items(json_data, "tasks");
         
-        crow::response res(200, response.dump());
-        res.add_header("Content-Type", "application/json");
-        res.add_header("Access-Control-Allow-Origin", "*");
-        return res;
+        std::vector<TaskBatchItem> items(elements.size());
+        std::vector<TaskBatchResult> results(elements.size());
+        for (size_t i = 0; i < elements.size(); ++i) {
+            std::string error;
+            if (!parse_batch_item(elements[i], true, items[i], error)) {
+                results[i] = {400, items[i].id, error};
+            }
+        }
+        
+        bool success = database->update_tasks(user_id, items, results);
+        response_cache.invalidate_owner(user_id);
+        change_hub.notify();
+        if (!success) {
+            auto error = create_error_response("Failed to update tasks");
+            return crow::response(500, dump_json(error));
+        }
+        return batch_response("Tasks processed", results);
+        
+    } catch (const nlohmann::json::exception& e) {
+        auto error = create_error_response("Invalid JSON format");
+        return crow::response(400, dump_json(error));
+    } catch (const std::invalid_argument& e) {
+        auto error = create_error_response(e.what());
+        return crow::response(400, dump_json(error));
+    } catch (const std::exception& e) {
+        auto error = create_error_response("Internal server error");
+        return crow::response(500, dump_json(error));
+    }
+}
+
+crow::response APIRoutes::delete_tasks_batch(const crow::request& req) {
+    // Authentication required
+    auto auth_result = authenticate_request(req);
+    if (!auth_result.has_value()) {
+        auto error = create_error_response("Authentication required");
+        return crow::response(401, dump_json(error));
+    }
+    
+    int user_id = auth_result->first;
+    
+    try {
+        auto json_data = parse_body(req);
+        const auto& elements = batch_items(json_data, "ids");
+        
+        std::vector<int> task_ids(elements.size());
+        std::vector<TaskBatchResult> results(elements.size());
+        for (size_t i = 0; i < elements.size(); ++i) {
+            if (elements[i].is_number_integer()) {
+                task_ids[i] = elements[i].get<int>();
+            } else {
+                results[i] = {400, 0, "Task id must be an integer"};
+            }
+        }
+        
+        bool success = database->delete_tasks(user_id, task_ids, results);
+        response_cache.invalidate_owner(user_id);
+        change_hub.notify();
+        if (!success) {
+            auto error = create_error_response("Failed to delete tasks");
+            return crow::response(500, dump_json(error));
+        }
+        return batch_response("Tasks processed", results);
         
+    } catch (const nlohmann::json::exception& e) {
+        auto error = create_error_response("Invalid JSON format");
+        return crow::response(400, dump_json(error));
+    } catch (const std::invalid_argument& e) {
+        auto error = create_error_response(e.what());
+        return crow::response(400, dump_json(error));
     } catch (const std::exception& e) {
         auto error = create_error_response("Internal server error");
-        return crow::response(500, error.dump());
+        return crow::response(500, dump_json(error));
     }
 }
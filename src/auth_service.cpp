@@ -6,12 +6,404 @@
 #include <cstring>
 #include <nlohmann/json.hpp>
 #include <random>
+#include <charconv>
+#include <cstdint>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
 
 const std::string AuthService::JWT_SECRET = "your-super-secret-jwt-key-change-this-in-production";
 const int AuthService::JWT_EXPIRY_HOURS = 24;
+std::atomic<int> AuthService::PBKDF2_ITERATIONS{600000};
+
+namespace {
+    // base64url({"alg":"HS256","typ":"JWT"})
+    const std::string_view JWT_HEADER_SEGMENT = "eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9";
+    
+    // Decoded payloads larger than this are rejected; ours are well under 200 bytes
+    const size_t MAX_PAYLOAD_BYTES = 1024;
+    
+    const std::string_view PBKDF2_PREFIX = "pbkdf2_sha256$";
+    const size_t PBKDF2_SALT_BYTES = 16;
+    const size_t PBKDF2_HASH_BYTES = 32;
+    // Stored hashes above this are rejected rather than burning a worker on them
+    const int PBKDF2_MAX_ITERATIONS = 10000000;
+    
+    struct EncodedHash {
+        int iterations = 0;
+        std::string_view salt;
+        std::string_view hash;
+    };
+    
+    const char BASE64URL_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    
+    int base64url_value(char c) {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '-') return 62;
+        if (c == '_') return 63;
+        return -1;
+    }
+    
+    void base64url_encode(std::string_view input, std::string& out) {
+        size_t i = 0;
+        for (; i + 2 < input.size(); i += 3) {
+            uint32_t n = (uint8_t(input[i]) << 16) | (uint8_t(input[i + 1]) << 8) | uint8_t(input[i + 2]);
+            out += BASE64URL_ALPHABET[(n >> 18) & 63];
+            out += BASE64URL_ALPHABET[(n >> 12) & 63];
+            out += BASE64URL_ALPHABET[(n >> 6) & 63];
+            out += BASE64URL_ALPHABET[n & 63];
+        }
+        if (i + 1 == input.size()) {
+            uint32_t n = uint8_t(input[i]) << 16;
+            out += BASE64URL_ALPHABET[(n >> 18) & 63];
+            out += BASE64URL_ALPHABET[(n >> 12) & 63];
+        } else if (i + 2 == input.size()) {
+            uint32_t n = (uint8_t(input[i]) << 16) | (uint8_t(input[i + 1]) << 8);
+            out += BASE64URL_ALPHABET[(n >> 18) & 63];
+            out += BASE64URL_ALPHABET[(n >> 12) & 63];
+            out += BASE64URL_ALPHABET[(n >> 6) & 63];
+        }
+    }
+    
+    // Unpadded base64url into a caller-provided buffer
+    bool base64url_decode(std::string_view input, unsigned char* out, size_t capacity, size_t& length) {
+        if (input.size() % 4 == 1 || input.size() / 4 * 3 + 2 > capacity) {
+            return false;
+        }
+        
+        length = 0;
+        uint32_t buffer = 0;
+        int bits = 0;
+        for (char c : input) {
+            int value = base64url_value(c);
+            if (value < 0) {
+                return false;
+            }
+            buffer = (buffer << 6) | static_cast<uint32_t>(value);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                out[length++] = static_cast<unsigned char>((buffer >> bits) & 0xFF);
+            }
+        }
+        return true;
+    }
+    
+    // Minimal scanner for the flat claims object we issue: string, integer and
+    // literal values only. Only username is materialized.
+    class ClaimsScanner {
+    public:
+        explicit ClaimsScanner(std::string_view json) : json(json) {}
+        
+        bool parse(AuthService::TokenClaims& claims) {
+            bool has_user_id = false, has_username = false, has_exp = false;
+            
+            skip_whitespace();
+            if (!consume('{')) {
+                return false;
+            }
+            skip_whitespace();
+            if (consume('}')) {
+                return false;
+            }
+            
+            while (true) {
+                std::string_view key;
+                skip_whitespace();
+                if (!read_key(key)) {
+                    return false;
+                }
+                skip_whitespace();
+                if (!consume(':')) {
+                    return false;
+                }
+                skip_whitespace();
+                
+                if (key == "username") {
+                    claims.username.clear();
+                    if (!read_string(&claims.username)) {
+                        return false;
+                    }
+                    has_username = true;
+                } else if (key == "user_id" || key == "exp" || key == "iat") {
+                    long long value;
+                    if (!read_integer(value)) {
+                        return false;
+                    }
+                    if (key == "user_id") {
+                        if (value < INT32_MIN || value > INT32_MAX) {
+                            return false;
+                        }
+                        claims.user_id = static_cast<int>(value);
+                        has_user_id = true;
+                    } else if (key == "exp") {
+                        claims.expires_at = value;
+                        has_exp = true;
+                    } else {
+                        claims.issued_at = value;
+                    }
+                } else if (!skip_value()) {
+                    return false;
+                }
+                
+                skip_whitespace();
+                if (consume(',')) {
+                    continue;
+                }
+                if (consume('}')) {
+                    break;
+                }
+                return false;
+            }
+            
+            return has_user_id && has_username && has_exp;
+        }
+        
+    private:
+        std::string_view json;
+        size_t pos = 0;
+        
+        void skip_whitespace() {
+            while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' || json[pos] == '\r')) {
+                ++pos;
+            }
+        }
+        
+        bool consume(char c) {
+            if (pos < json.size() && json[pos] == c) {
+                ++pos;
+                return true;
+            }
+            return false;
+        }
+        
+        // Keys we look for never contain escapes, so an escaped key is compared raw and ignored
+        bool read_key(std::string_view& key) {
+            size_t start = pos + 1;
+            if (!read_string(nullptr)) {
+                return false;
+            }
+            key = json.substr(start, pos - start - 1);
+            return true;
+        }
+        
+        bool read_string(std::string* out) {
+            if (!consume('"')) {
+                return false;
+            }
+            while (pos < json.size()) {
+                char c = json[pos++];
+                if (c == '"') {
+                    return true;
+                }
+                if (c != '\\') {
+                    if (out) {
+                        *out += c;
+                    }
+                    continue;
+                }
+                if (pos >= json.size()) {
+                    return false;
+                }
+                char escape = json[pos++];
+                switch (escape) {
+                    case '"': case '\\': case '/': if (out) *out += escape; break;
+                    case 'b': if (out) *out += '\b'; break;
+                    case 'f': if (out) *out += '\f'; break;
+                    case 'n': if (out) *out += '\n'; break;
+                    case 'r': if (out) *out += '\r'; break;
+                    case 't': if (out) *out += '\t'; break;
+                    case 'u': {
+                        uint32_t code;
+                        if (!read_hex4(code)) {
+                            return false;
+                        }
+                        if (code >= 0xD800 && code <= 0xDBFF) {
+                            uint32_t low;
+                            if (!consume('\\') || !consume('u') || !read_hex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                                return false;
+                            }
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        if (out) {
+                            append_utf8(*out, code);
+                        }
+                        break;
+                    }
+                    default:
+                        return false;
+                }
+            }
+            return false;
+        }
+        
+        bool read_hex4(uint32_t& code) {
+            if (pos + 4 > json.size()) {
+                return false;
+            }
+            code = 0;
+            for (int i = 0; i < 4; ++i) {
+                char c = json[pos++];
+                code <<= 4;
+                if (c >= '0' && c <= '9') code |= c - '0';
+                else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+                else return false;
+            }
+            return true;
+        }
+        
+        static void append_utf8(std::string& out, uint32_t code) {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+        
+        bool read_integer(long long& value) {
+            auto result = std::from_chars(json.data() + pos, json.data() + json.size(), value);
+            if (result.ec != std::errc()) {
+                return false;
+            }
+            pos = result.ptr - json.data();
+            return true;
+        }
+        
+        bool skip_value() {
+            if (pos >= json.size()) {
+                return false;
+            }
+            char c = json[pos];
+            if (c == '"') {
+                return read_string(nullptr);
+            }
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                while (pos < json.size() && (std::strchr("+-.eE", json[pos]) || (json[pos] >= '0' && json[pos] <= '9'))) {
+                    ++pos;
+                }
+                return true;
+            }
+            for (std::string_view literal : {"true", "false", "null"}) {
+                if (json.substr(pos, literal.size()) == literal) {
+                    pos += literal.size();
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+}
+
+bool AuthService::parse_claims(std::string_view payload, TokenClaims& claims) {
+    return ClaimsScanner(payload).parse(claims);
+}
+
+namespace {
+    bool parse_encoded_hash(std::string_view encoded, EncodedHash& parsed) {
+        if (encoded.substr(0, PBKDF2_PREFIX.size()) != PBKDF2_PREFIX) {
+            return false;
+        }
+        encoded.remove_prefix(PBKDF2_PREFIX.size());
+        
+        size_t salt_start = encoded.find('$');
+        size_t hash_start = salt_start == std::string_view::npos ? salt_start : encoded.find('$', salt_start + 1);
+        if (hash_start == std::string_view::npos) {
+            return false;
+        }
+        
+        auto result = std::from_chars(encoded.data(), encoded.data() + salt_start, parsed.iterations);
+        if (result.ec != std::errc() || result.ptr != encoded.data() + salt_start ||
+            parsed.iterations <= 0 || parsed.iterations > PBKDF2_MAX_ITERATIONS) {
+            return false;
+        }
+        
+        parsed.salt = encoded.substr(salt_start + 1, hash_start - salt_start - 1);
+        parsed.hash = encoded.substr(hash_start + 1);
+        return true;
+    }
+    
+    bool derive_key(const std::string& password, const unsigned char* salt, size_t salt_length,
+                    int iterations, unsigned char* key) {
+        return PKCS5_PBKDF2_HMAC(password.data(), static_cast<int>(password.size()),
+                                 salt, static_cast<int>(salt_length), iterations, EVP_sha256(),
+                                 static_cast<int>(PBKDF2_HASH_BYTES), key) == 1;
+    }
+}
+
+void AuthService::set_pbkdf2_iterations(int iterations) {
+    if (iterations > 0 && iterations <= PBKDF2_MAX_ITERATIONS) {
+        PBKDF2_ITERATIONS.store(iterations, std::memory_order_relaxed);
+    }
+}
+
+int AuthService::pbkdf2_iterations() {
+    return PBKDF2_ITERATIONS.load(std::memory_order_relaxed);
+}
 
 std::string AuthService::hash_password(const std::string& password) {
-    // Simplified hash function for now (use proper hashing in production)
+    unsigned char salt[PBKDF2_SALT_BYTES];
+    unsigned char key[PBKDF2_HASH_BYTES];
+    int iterations = pbkdf2_iterations();
+    if (RAND_bytes(salt, sizeof(salt)) != 1 || !derive_key(password, salt, sizeof(salt), iterations, key)) {
+        std::cerr << "Failed to derive password hash" << std::endl;
+        return std::string();
+    }
+    
+    std::string encoded(PBKDF2_PREFIX);
+    encoded += std::to_string(iterations);
+    encoded += '$';
+    base64url_encode(std::string_view(reinterpret_cast<const char*>(salt), sizeof(salt)), encoded);
+    encoded += '$';
+    base64url_encode(std::string_view(reinterpret_cast<const char*>(key), sizeof(key)), encoded);
+    return encoded;
+}
+
+bool AuthService::verify_password(const std::string& password, const std::string& stored_hash) {
+    EncodedHash parsed;
+    if (!parse_encoded_hash(stored_hash, parsed)) {
+        // Accounts created before PBKDF2; re-hashed on their next successful login
+        std::string legacy = legacy_hash_password(password);
+        return !stored_hash.empty() && legacy.size() == stored_hash.size() &&
+               CRYPTO_memcmp(legacy.data(), stored_hash.data(), legacy.size()) == 0;
+    }
+    
+    unsigned char salt[PBKDF2_SALT_BYTES * 4];
+    unsigned char expected[PBKDF2_HASH_BYTES + 2];
+    unsigned char actual[PBKDF2_HASH_BYTES];
+    size_t salt_length = 0, expected_length = 0;
+    if (!base64url_decode(parsed.salt, salt, sizeof(salt), salt_length) ||
+        !base64url_decode(parsed.hash, expected, sizeof(expected), expected_length) ||
+        expected_length != PBKDF2_HASH_BYTES) {
+        return false;
+    }
+    
+    return derive_key(password, salt, salt_length, parsed.iterations, actual) &&
+           CRYPTO_memcmp(actual, expected, PBKDF2_HASH_BYTES) == 0;
+}
+
+bool AuthService::needs_rehash(const std::string& stored_hash) {
+    EncodedHash parsed;
+    return !parse_encoded_hash(stored_hash, parsed) || parsed.iterations < pbkdf2_iterations();
+}
+
+std::string AuthService::legacy_hash_password(const std::string& password) {
+    // Original scheme: std::hash with a fixed salt. Only ever used to verify old rows.
     std::hash<std::string> hasher;
     size_t hash = hasher(password + "salt123");
     
@@ -20,65 +412,123 @@ std::string AuthService::hash_password(const std::string& password) {
     return ss.str();
 }
 
-bool AuthService::verify_password(const std::string& password, const std::string& stored_hash) {
-    return hash_password(password) == stored_hash;
-}
-
 std::string AuthService::generate_jwt_token(int user_id, const std::string& username) {
-    // Simplified token generation (use proper JWT in production)
+    auto now = std::chrono::system_clock::now();
+    auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+    
     nlohmann::json payload;
     payload["user_id"] = user_id;
     payload["username"] = username;
+    payload["iat"] = timestamp;
+    payload["exp"] = timestamp + (JWT_EXPIRY_HOURS * 3600);
+    
+    std::string token(JWT_HEADER_SEGMENT);
+    token += '.';
+    base64url_encode(payload.dump(), token);
+    
+    unsigned char signature[SHA256_DIGEST_LENGTH];
+    if (!sign(token, signature)) {
+        return std::string();
+    }
+    
+    token += '.';
+    base64url_encode(std::string_view(reinterpret_cast<const char*>(signature), sizeof(signature)), token);
+    return token;
+}
+
+std::optional<AuthService::TokenClaims> AuthService::decode_jwt_token(std::string_view token) {
+    size_t first_dot = token.find('.');
+    size_t second_dot = first_dot == std::string_view::npos ? first_dot : token.find('.', first_dot + 1);
+    if (second_dot == std::string_view::npos) {
+        return std::nullopt;
+    }
+    
+    // Only the exact header we issue is accepted, which rules out alg confusion
+    if (token.substr(0, first_dot) != JWT_HEADER_SEGMENT) {
+        return std::nullopt;
+    }
+    
+    std::string_view signing_input = token.substr(0, second_dot);
+    std::string_view encoded_signature = token.substr(second_dot + 1);
+    
+    unsigned char expected[SHA256_DIGEST_LENGTH];
+    unsigned char provided[SHA256_DIGEST_LENGTH + 2];
+    size_t provided_length = 0;
+    if (!base64url_decode(encoded_signature, provided, sizeof(provided), provided_length) ||
+        provided_length != SHA256_DIGEST_LENGTH || !sign(signing_input, expected) ||
+        CRYPTO_memcmp(expected, provided, SHA256_DIGEST_LENGTH) != 0) {
+        return std::nullopt;
+    }
+    
+    char payload[MAX_PAYLOAD_BYTES];
+    size_t payload_length = 0;
+    std::string_view encoded_payload = token.substr(first_dot + 1, second_dot - first_dot - 1);
+    if (!base64url_decode(encoded_payload, reinterpret_cast<unsigned char*>(payload), sizeof(payload), payload_length)) {
+        return std::nullopt;
+    }
+    
+    TokenClaims claims;
+    if (!parse_claims(std::string_view(payload, payload_length), claims)) {
+        return std::nullopt;
+    }
     
     auto now = std::chrono::system_clock::now();
     auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
-    payload["exp"] = timestamp + (JWT_EXPIRY_HOURS * 3600);
-    
-    std::string token = payload.dump();
+    if (claims.expires_at < timestamp) {
+        return std::nullopt;
+    }
     
-    // Simple base64-like encoding
-    std::string encoded;
-    for (char c : token) {
-        encoded += std::to_string(static_cast<int>(c)) + ".";
+    return claims;
+}
+
+std::optional<std::pair<int, std::string>> AuthService::verify_jwt_token(std::string_view token) {
+    auto claims = decode_jwt_token(token);
+    if (!claims) {
+        return std::nullopt;
     }
     
-    return encoded;
+    return std::make_pair(claims->user_id, std::move(claims->username));
 }
 
-std::optional<std::pair<int, std::string>> AuthService::verify_jwt_token(const std::string& token) {
-    try {
-        // Simple token verification (use proper JWT in production)
-        std::string decoded;
-        std::stringstream ss(token);
-        std::string segment;
+bool AuthService::sign(std::string_view signing_input, unsigned char* signature) {
+    // One keyed HMAC context per thread; re-initializing with a NULL key reuses the key schedule
+    struct MacContext {
+        EVP_MAC* mac = nullptr;
+        EVP_MAC_CTX* ctx = nullptr;
+        bool keyed = false;
         
-        while (std::getline(ss, segment, '.')) {
-            if (!segment.empty()) {
-                decoded += static_cast<char>(std::stoi(segment));
-            }
+        MacContext() {
+            mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+            ctx = mac ? EVP_MAC_CTX_new(mac) : nullptr;
         }
-        
-        if (decoded.empty()) {
-            return std::nullopt;
-        }
-        
-        auto payload = nlohmann::json::parse(decoded);
-        
-        // Check expiration
-        auto now = std::chrono::system_clock::now();
-        auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
-        
-        if (payload["exp"].get<long>() < timestamp) {
-            return std::nullopt;
+        ~MacContext() {
+            EVP_MAC_CTX_free(ctx);
+            EVP_MAC_free(mac);
         }
-        
-        int user_id = payload["user_id"];
-        std::string username = payload["username"];
-        
-        return std::make_pair(user_id, username);
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Token verification failed: " << e.what() << std::endl;
-        return std::nullopt;
+    };
+    thread_local MacContext context;
+    
+    if (!context.ctx) {
+        return false;
+    }
+    
+    int initialized;
+    if (!context.keyed) {
+        char digest[] = "SHA256";
+        OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+            OSSL_PARAM_construct_end()
+        };
+        initialized = EVP_MAC_init(context.ctx, reinterpret_cast<const unsigned char*>(JWT_SECRET.data()),
+                                   JWT_SECRET.size(), params);
+        context.keyed = initialized == 1;
+    } else {
+        initialized = EVP_MAC_init(context.ctx, nullptr, 0, nullptr);
     }
+    
+    size_t length = 0;
+    return initialized == 1 &&
+        EVP_MAC_update(context.ctx, reinterpret_cast<const unsigned char*>(signing_input.data()), signing_input.size()) == 1 &&
+        EVP_MAC_final(context.ctx, signature, &length, SHA256_DIGEST_LENGTH) == 1 &&
+        length == SHA256_DIGEST_LENGTH;
 }
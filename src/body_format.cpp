@@ -0,0 +1,582 @@
+#include "body_format.h"
+#include "input_validator.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+    bool is_msgpack(std::string_view type) {
+        return InputValidator::equals_ignore_case(type, "application/msgpack") ||
+               InputValidator::equals_ignore_case(type, "application/x-msgpack") ||
+               InputValidator::equals_ignore_case(type, "application/vnd.msgpack");
+    }
+
+    bool is_cbor(std::string_view type) {
+        return InputValidator::equals_ignore_case(type, "application/cbor");
+    }
+
+    // Streaming JSON text -> MessagePack/CBOR, without building a DOM. Both formats put
+    // the element count in front of each array and map, so the text is walked twice:
+    // the first pass (Counter) validates it and records every container's size in
+    // order of appearance, the second (Writer) emits. Output matches what
+    // nlohmann::json::to_msgpack/to_cbor write, except that object keys keep their
+    // order instead of being sorted.
+    class Counter {
+    public:
+        static constexpr bool WANTS_VALUES = false;
+
+        explicit Counter(std::vector<size_t>& counts) : counts(counts) {}
+
+        void begin_container(bool object) {
+            scalar();
+            open.push_back({counts.size(), object});
+            counts.push_back(0);
+        }
+        void end_container() { open.pop_back(); }
+        // Maps count key/value pairs, arrays count values
+        void key(std::string_view) { ++counts[open.back().index]; }
+        void scalar() {
+            if (!open.empty() && !open.back().object) {
+                ++counts[open.back().index];
+            }
+        }
+        void null() { scalar(); }
+        void boolean(bool) { scalar(); }
+        void integer(int64_t) { scalar(); }
+        void unsigned_integer(uint64_t) { scalar(); }
+        void floating(double) { scalar(); }
+        void string(std::string_view) { scalar(); }
+
+    private:
+        struct Open {
+            size_t index;
+            bool object;
+        };
+
+        std::vector<size_t>& counts;
+        std::vector<Open> open;
+    };
+
+    class Writer {
+    public:
+        static constexpr bool WANTS_VALUES = true;
+
+        Writer(BodyFormat::Format format, const std::vector<size_t>& counts, std::string& out)
+            : cbor(format == BodyFormat::Format::Cbor), counts(counts), out(out) {}
+
+        void begin_container(bool object) {
+            size_t count = counts[next_count++];
+            if (cbor) {
+                cbor_head(object ? 5 : 4, count);
+            } else if (count < 16) {
+                byte((object ? 0x80 : 0x90) | count);
+            } else if (count <= 0xffff) {
+                byte(object ? 0xde : 0xdc);
+                big_endian(count, 2);
+            } else {
+                byte(object ? 0xdf : 0xdd);
+                big_endian(count, 4);
+            }
+        }
+        void end_container() {}
+        void key(std::string_view text) { string(text); }
+
+        void null() { byte(cbor ? 0xf6 : 0xc0); }
+        void boolean(bool value) { byte(cbor ? (value ? 0xf5 : 0xf4) : (value ? 0xc3 : 0xc2)); }
+
+        void integer(int64_t value) {
+            if (value >= 0) {
+                unsigned_integer(static_cast<uint64_t>(value));
+            } else if (cbor) {
+                cbor_head(1, static_cast<uint64_t>(-(value + 1)));
+            } else if (value >= -32) {
+                byte(static_cast<uint8_t>(value));
+            } else if (value >= INT8_MIN) {
+                byte(0xd0);
+                big_endian(static_cast<uint64_t>(value), 1);
+            } else if (value >= INT16_MIN) {
+                byte(0xd1);
+                big_endian(static_cast<uint64_t>(value), 2);
+            } else if (value >= INT32_MIN) {
+                byte(0xd2);
+                big_endian(static_cast<uint64_t>(value), 4);
+            } else {
+                byte(0xd3);
+                big_endian(static_cast<uint64_t>(value), 8);
+            }
+        }
+
+        void unsigned_integer(uint64_t value) {
+            if (cbor) {
+                cbor_head(0, value);
+            } else if (value < 128) {
+                byte(value);
+            } else if (value <= 0xff) {
+                byte(0xcc);
+                big_endian(value, 1);
+            } else if (value <= 0xffff) {
+                byte(0xcd);
+                big_endian(value, 2);
+            } else if (value <= 0xffffffff) {
+                byte(0xce);
+                big_endian(value, 4);
+            } else {
+                byte(0xcf);
+                big_endian(value, 8);
+            }
+        }
+
+        void floating(double value) {
+            // Single precision when it round-trips, as nlohmann does
+            float narrow = static_cast<float>(value);
+            if (value >= std::numeric_limits<float>::lowest() && value <= std::numeric_limits<float>::max() &&
+                static_cast<double>(narrow) == value) {
+                uint32_t bits;
+                std::memcpy(&bits, &narrow, sizeof(bits));
+                byte(cbor ? 0xfa : 0xca);
+                big_endian(bits, 4);
+            } else {
+                uint64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                byte(cbor ? 0xfb : 0xcb);
+                big_endian(bits, 8);
+            }
+        }
+
+        void string(std::string_view text) {
+            size_t length = text.size();
+            if (cbor) {
+                cbor_head(3, length);
+            } else if (length < 32) {
+                byte(0xa0 | length);
+            } else if (length <= 0xff) {
+                byte(0xd9);
+                big_endian(length, 1);
+            } else if (length <= 0xffff) {
+                byte(0xda);
+                big_endian(length, 2);
+            } else {
+                byte(0xdb);
+                big_endian(length, 4);
+            }
+            out.append(text.data(), length);
+        }
+
+    private:
+        bool cbor;
+        const std::vector<size_t>& counts;
+        size_t next_count = 0;
+        std::string& out;
+
+        void byte(uint64_t value) { out.push_back(static_cast<char>(value)); }
+
+        void big_endian(uint64_t value, int bytes) {
+            for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+                byte((value >> shift) & 0xff);
+            }
+        }
+
+        void cbor_head(int major, uint64_t value) {
+            int type = major << 5;
+            if (value < 24) {
+                byte(type | value);
+            } else if (value <= 0xff) {
+                byte(type | 24);
+                big_endian(value, 1);
+            } else if (value <= 0xffff) {
+                byte(type | 25);
+                big_endian(value, 2);
+            } else if (value <= 0xffffffff) {
+                byte(type | 26);
+                big_endian(value, 4);
+            } else {
+                byte(type | 27);
+                big_endian(value, 8);
+            }
+        }
+    };
+
+    class JsonWalker {
+    public:
+        explicit JsonWalker(const std::string& text) : text(text) {}
+
+        // Feeds every token of text to sink; false on malformed JSON
+        template <typename Sink>
+        bool walk(Sink& sink) {
+            enum class Expect { Value, FirstElement, FirstKey, Key, AfterValue };
+            pos = 0;
+            open.clear();
+            Expect expect = Expect::Value;
+
+            while (true) {
+                skip_space();
+                if (expect == Expect::AfterValue) {
+                    if (open.empty()) {
+                        return pos == text.size();
+                    }
+                    if (pos >= text.size()) {
+                        return false;
+                    }
+                    char c = text[pos++];
+                    if (c == ',') {
+                        expect = open.back() == '[' ? Expect::Value : Expect::Key;
+                    } else if (c == (open.back() == '[' ? ']' : '}')) {
+                        open.pop_back();
+                        sink.end_container();
+                    } else {
+                        return false;
+                    }
+                    continue;
+                }
+
+                if (pos >= text.size()) {
+                    return false;
+                }
+                char c = text[pos];
+                if (expect == Expect::FirstElement || expect == Expect::FirstKey) {
+                    if (c == (expect == Expect::FirstElement ? ']' : '}')) {
+                        ++pos;
+                        open.pop_back();
+                        sink.end_container();
+                        expect = Expect::AfterValue;
+                        continue;
+                    }
+                    expect = expect == Expect::FirstElement ? Expect::Value : Expect::Key;
+                }
+
+                if (expect == Expect::Key) {
+                    if (c != '"' || !read_string<Sink::WANTS_VALUES>()) {
+                        return false;
+                    }
+                    sink.key(value);
+                    skip_space();
+                    if (pos >= text.size() || text[pos++] != ':') {
+                        return false;
+                    }
+                    expect = Expect::Value;
+                    continue;
+                }
+
+                // A value
+                expect = Expect::AfterValue;
+                if (c == '{' || c == '[') {
+                    ++pos;
+                    open.push_back(c);
+                    sink.begin_container(c == '{');
+                    expect = c == '{' ? Expect::FirstKey : Expect::FirstElement;
+                } else if (c == '"') {
+                    if (!read_string<Sink::WANTS_VALUES>()) {
+                        return false;
+                    }
+                    sink.string(value);
+                } else if (literal("true")) {
+                    sink.boolean(true);
+                } else if (literal("false")) {
+                    sink.boolean(false);
+                } else if (literal("null")) {
+                    sink.null();
+                } else if (!read_number(sink)) {
+                    return false;
+                }
+            }
+        }
+
+    private:
+        const std::string& text;
+        size_t pos = 0;
+        std::vector<char> open;
+        std::string scratch;
+        std::string_view value;     // the last string read, in text or in scratch
+
+        void skip_space() {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t')) {
+                ++pos;
+            }
+        }
+
+        bool literal(const char* word) {
+            size_t length = std::strlen(word);
+            if (text.compare(pos, length, word) != 0) {
+                return false;
+            }
+            pos += length;
+            return true;
+        }
+
+        static int hex_value(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        bool read_hex4(unsigned& value) {
+            if (pos + 4 > text.size()) {
+                return false;
+            }
+            value = 0;
+            for (int i = 0; i < 4; ++i) {
+                int digit = hex_value(text[pos++]);
+                if (digit < 0) {
+                    return false;
+                }
+                value = value * 16 + digit;
+            }
+            return true;
+        }
+
+        void append_utf8(unsigned code_point) {
+            if (code_point < 0x80) {
+                scratch += static_cast<char>(code_point);
+            } else if (code_point < 0x800) {
+                scratch += static_cast<char>(0xc0 | (code_point >> 6));
+                scratch += static_cast<char>(0x80 | (code_point & 0x3f));
+            } else if (code_point < 0x10000) {
+                scratch += static_cast<char>(0xe0 | (code_point >> 12));
+                scratch += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+                scratch += static_cast<char>(0x80 | (code_point & 0x3f));
+            } else {
+                scratch += static_cast<char>(0xf0 | (code_point >> 18));
+                scratch += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+                scratch += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+                scratch += static_cast<char>(0x80 | (code_point & 0x3f));
+            }
+        }
+
+        // Reads the string at pos into value (unescaped only when Decode); strings without
+        // escapes, the common case, are returned in place
+        template <bool Decode>
+        bool read_string() {
+            ++pos;
+            scratch.clear();
+            bool escaped = false;
+            while (true) {
+                size_t run = pos;
+                while (pos < text.size() && text[pos] != '"' && text[pos] != '\\' && static_cast<unsigned char>(text[pos]) >= 0x20) {
+                    if (static_cast<unsigned char>(text[pos]) < 0x80) {
+                        ++pos;
+                        continue;
+                    }
+                    // Binary formats carry strings as UTF-8 without checking, so the JSON
+                    // parser's rejection of malformed sequences has to happen here
+                    size_t sequence = InputValidator::utf8_sequence_length(std::string_view(text).substr(pos));
+                    if (sequence == 0) {
+                        return false;
+                    }
+                    pos += sequence;
+                }
+                if (pos >= text.size() || static_cast<unsigned char>(text[pos]) < 0x20) {
+                    return false;
+                }
+                if (text[pos] == '"' && !escaped) {
+                    value = std::string_view(text).substr(run, pos++ - run);
+                    return true;
+                }
+                if (Decode) {
+                    scratch.append(text, run, pos - run);
+                }
+                if (text[pos++] == '"') {
+                    value = scratch;
+                    return true;
+                }
+                escaped = true;
+
+                if (pos >= text.size()) {
+                    return false;
+                }
+                char escape = text[pos++];
+                unsigned code_point = 0;
+                switch (escape) {
+                    case '"': case '\\': case '/': code_point = escape; break;
+                    case 'b': code_point = '\b'; break;
+                    case 'f': code_point = '\f'; break;
+                    case 'n': code_point = '\n'; break;
+                    case 'r': code_point = '\r'; break;
+                    case 't': code_point = '\t'; break;
+                    case 'u': {
+                        if (!read_hex4(code_point)) {
+                            return false;
+                        }
+                        if (code_point >= 0xd800 && code_point <= 0xdbff) {
+                            unsigned low;
+                            if (text.compare(pos, 2, "\\u") != 0) {
+                                return false;
+                            }
+                            pos += 2;
+                            if (!read_hex4(low) || low < 0xdc00 || low > 0xdfff) {
+                                return false;
+                            }
+                            code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+                        } else if (code_point >= 0xdc00 && code_point <= 0xdfff) {
+                            return false;
+                        }
+                        break;
+                    }
+                    default:
+                        return false;
+                }
+                if (Decode) {
+                    append_utf8(code_point);
+                }
+            }
+        }
+
+        // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+        template <typename Sink>
+        bool read_number(Sink& sink) {
+            size_t start = pos;
+            bool negative = text[pos] == '-';
+            if (negative) {
+                ++pos;
+            }
+            auto digits = [this]() {
+                size_t first = pos;
+                while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+                    ++pos;
+                }
+                return pos - first;
+            };
+
+            size_t integer_digits = digits();
+            if (integer_digits == 0 || (integer_digits > 1 && text[pos - integer_digits] == '0')) {
+                return false;
+            }
+            bool is_integer = true;
+            if (pos < text.size() && text[pos] == '.') {
+                ++pos;
+                if (digits() == 0) {
+                    return false;
+                }
+                is_integer = false;
+            }
+            if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+                ++pos;
+                if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+                    ++pos;
+                }
+                if (digits() == 0) {
+                    return false;
+                }
+                is_integer = false;
+            }
+            if constexpr (!Sink::WANTS_VALUES) {
+                sink.scalar();
+                return true;
+            }
+
+            // Integers that overflow 64 bits become doubles, as in nlohmann::json::parse
+            const char* begin = text.c_str() + start;
+            if (is_integer) {
+                errno = 0;
+                char* end = nullptr;
+                if (negative) {
+                    long long value = std::strtoll(begin, &end, 10);
+                    if (errno == 0) {
+                        sink.integer(value);
+                        return true;
+                    }
+                } else {
+                    unsigned long long value = std::strtoull(begin, &end, 10);
+                    if (errno == 0) {
+                        sink.unsigned_integer(value);
+                        return true;
+                    }
+                }
+            }
+            sink.floating(std::strtod(begin, nullptr));
+            return true;
+        }
+    };
+}
+
+BodyFormat::Format BodyFormat::from_accept(const std::string& accept) {
+    if (accept.empty()) {
+        return Format::Json;
+    }
+
+    // -1 = not listed; JSON then falls back to application/* or */*
+    double json = -1, msgpack = 0, cbor = 0, wildcard = -1;
+    InputValidator::parse_quality_list(accept, [&](std::string_view type, double q) {
+        if (InputValidator::equals_ignore_case(type, "application/json")) {
+            json = q;
+        } else if (is_msgpack(type)) {
+            msgpack = q;
+        } else if (is_cbor(type)) {
+            cbor = q;
+        } else if (type == "*/*" || InputValidator::equals_ignore_case(type, "application/*")) {
+            wildcard = std::max(wildcard, q);
+        }
+    });
+    if (json < 0) {
+        json = std::max(wildcard, 0.0);
+    }
+
+    if (msgpack > json && msgpack >= cbor) {
+        return Format::MsgPack;
+    }
+    return cbor > json ? Format::Cbor : Format::Json;
+}
+
+BodyFormat::Format BodyFormat::from_content_type(const std::string& content_type) {
+    std::string_view type = content_type;
+    type = type.substr(0, type.find(';'));
+    while (!type.empty() && type.back() == ' ') {
+        type.remove_suffix(1);
+    }
+    if (is_msgpack(type)) {
+        return Format::MsgPack;
+    }
+    return is_cbor(type) ? Format::Cbor : Format::Json;
+}
+
+const char* BodyFormat::content_type(Format format) {
+    switch (format) {
+        case Format::MsgPack: return "application/msgpack";
+        case Format::Cbor: return "application/cbor";
+        default: return "application/json";
+    }
+}
+
+const char* BodyFormat::name(Format format) {
+    switch (format) {
+        case Format::MsgPack: return "msgpack";
+        case Format::Cbor: return "cbor";
+        default: return "json";
+    }
+}
+
+bool BodyFormat::transcode(Format format, std::string& body) {
+    if (format == Format::Json) {
+        return true;
+    }
+
+    // Scratch kept between requests on the same thread, like the JSON response buffer
+    thread_local std::vector<size_t> counts;
+    thread_local std::string encoded;
+    counts.clear();
+    encoded.clear();
+
+    JsonWalker walker(body);
+    Counter counter(counts);
+    if (!walker.walk(counter)) {
+        return false;
+    }
+    encoded.reserve(body.size());
+    Writer writer(format, counts, encoded);
+    walker.walk(writer);
+    body.swap(encoded);
+
+    // encoded now holds the JSON body's capacity; after an export that is up to
+    // Database::MAX_EXPORT_BYTES, which no worker should keep
+    if (encoded.capacity() > MAX_RETAINED_BYTES) {
+        std::string().swap(encoded);
+    }
+    if (counts.capacity() * sizeof(size_t) > MAX_RETAINED_BYTES) {
+        std::vector<size_t>().swap(counts);
+    }
+    return true;
+}
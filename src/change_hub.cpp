@@ -0,0 +1,236 @@
+#include "change_hub.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace {
+    // Fallback poll for a missed notify (e.g. a write committed by another process)
+    const std::chrono::seconds POLL_INTERVAL(1);
+}
+
+ChangeHub::ChangeHub(std::shared_ptr<Database> db, size_t ring_capacity)
+    : database(db), ring_capacity(std::max<size_t>(1, ring_capacity)) {
+    // Subscribers get changes from now on; older ones are in the change feed
+    published_seq = std::max<sqlite3_int64>(0, database->latest_change_seq());
+    publisher = std::thread(&ChangeHub::run, this);
+}
+
+ChangeHub::~ChangeHub() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    publisher.join();
+}
+
+ChangeHub::SubscriberId ChangeHub::subscribe(int user_id, Sink send, Closer close) {
+    auto subscriber = std::make_shared<Subscriber>();
+    subscriber->user_id = user_id;
+    subscriber->send = std::move(send);
+    subscriber->close = std::move(close);
+    subscriber->ring.resize(ring_capacity);
+
+    // The publisher advances published_seq under the shared lock, so every change after
+    // the seq reported here is delivered, none before it, and none ahead of this reply
+    std::unique_lock<std::shared_mutex> lock(subscribers_mutex);
+    subscriber->id = next_id++;
+    subscribers[subscriber->id] = subscriber;
+    by_user[user_id].push_back(subscriber);
+    subscriber->send("{\"type\":\"subscribed\",\"user_id\":" + std::to_string(user_id) +
+                     ",\"seq\":" + std::to_string(published_seq) + "}");
+    return subscriber->id;
+}
+
+void ChangeHub::unsubscribe(SubscriberId id) {
+    std::unique_lock<std::shared_mutex> lock(subscribers_mutex);
+    auto it = subscribers.find(id);
+    if (it == subscribers.end()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> subscriber_lock(it->second->mutex);
+        it->second->closed = true;
+    }
+    remove_locked(id);
+}
+
+void ChangeHub::remove_locked(SubscriberId id) {
+    auto it = subscribers.find(id);
+    if (it == subscribers.end()) {
+        return;
+    }
+
+    auto user = by_user.find(it->second->user_id);
+    if (user != by_user.end()) {
+        auto& list = user->second;
+        list.erase(std::remove(list.begin(), list.end(), it->second), list.end());
+        if (list.empty()) {
+            by_user.erase(user);
+        }
+    }
+    subscribers.erase(it);
+}
+
+void ChangeHub::ack(SubscriberId id, sqlite3_int64 seq) {
+    std::shared_ptr<Subscriber> subscriber;
+    {
+        std::shared_lock<std::shared_mutex> lock(subscribers_mutex);
+        auto it = subscribers.find(id);
+        if (it == subscribers.end()) {
+            return;
+        }
+        subscriber = it->second;
+    }
+
+    std::lock_guard<std::mutex> lock(subscriber->mutex);
+    while (subscriber->count > 0 && subscriber->ring[subscriber->head].seq <= seq) {
+        subscriber->pending_bytes -= subscriber->ring[subscriber->head].bytes;
+        subscriber->head = (subscriber->head + 1) % ring_capacity;
+        --subscriber->count;
+    }
+}
+
+void ChangeHub::notify() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        pending = true;
+    }
+    wake.notify_one();
+}
+
+ChangeHub::Stats ChangeHub::stats() const {
+    Stats stats;
+    {
+        std::shared_lock<std::shared_mutex> lock(subscribers_mutex);
+        stats.subscribers = subscribers.size();
+    }
+    stats.published = published.load(std::memory_order_relaxed);
+    stats.delivered = delivered.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ChangeHub::run() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake.wait_for(lock, POLL_INTERVAL, [this]() { return pending || stopping; });
+            if (stopping) {
+                return;
+            }
+            pending = false;
+        }
+
+        try {
+            while (publish_pending()) {
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Change hub publish error: " << e.what() << std::endl;
+        }
+    }
+}
+
+bool ChangeHub::publish_pending() {
+    bool idle;
+    {
+        std::shared_lock<std::shared_mutex> lock(subscribers_mutex);
+        idle = subscribers.empty();
+    }
+    if (idle) {
+        // Nobody to tell: skip ahead rather than render changes no one receives. The
+        // emptiness is checked again under the lock, so a subscriber that arrived in
+        // between is told the seq it will actually be served from.
+        sqlite3_int64 latest = database->latest_change_seq();
+        std::unique_lock<std::shared_mutex> lock(subscribers_mutex);
+        if (!subscribers.empty()) {
+            return true;
+        }
+        if (latest > published_seq) {
+            published_seq = latest;
+        }
+        return false;
+    }
+
+    // Read the batch without the hub's lock, so subscribe, ack and unsubscribe do not wait on SQLite
+    ChangeQuery query;
+    query.since = published_seq;
+    query.limit = PageQuery::MAX_LIMIT;
+
+    std::vector<Change> changes;
+    sqlite3_int64 last_seq = published_seq;
+    bool has_more = false;
+    bool success = database->visit_task_changes(query, [&](sqlite3_int64 seq, int user_id, const std::string& entry) {
+        changes.push_back(Change{seq, user_id, entry});
+    }, last_seq, has_more);
+    if (!success) {
+        // Whatever was read is still published; a failed read is retried from there
+        std::cerr << "Change hub failed to read the change feed" << std::endl;
+        has_more = false;
+    }
+
+    // Subscribers present when published_seq moves past the batch were told an earlier seq
+    // and get it; later ones are told last_seq. Delivery itself happens outside the lock.
+    std::vector<std::pair<size_t, std::shared_ptr<Subscriber>>> targets;
+    {
+        std::shared_lock<std::shared_mutex> lock(subscribers_mutex);
+        for (size_t i = 0; i < changes.size(); ++i) {
+            auto user = by_user.find(changes[i].user_id);
+            if (user == by_user.end()) {
+                continue;
+            }
+            for (const auto& subscriber : user->second) {
+                targets.emplace_back(i, subscriber);
+            }
+        }
+        published_seq = last_seq;
+    }
+    published.fetch_add(changes.size(), std::memory_order_relaxed);
+
+    std::vector<SubscriberId> slow;
+    std::string message;
+    size_t rendered = changes.size();
+    for (const auto& [index, subscriber] : targets) {
+        if (index != rendered) {
+            // {"type":"change", followed by the feed entry's own fields
+            message = "{\"type\":\"change\",";
+            message.append(changes[index].entry, 1, std::string::npos);
+            rendered = index;
+        }
+        if (!deliver(*subscriber, changes[index].seq, message)) {
+            slow.push_back(subscriber->id);
+        }
+    }
+
+    if (!slow.empty()) {
+        std::unique_lock<std::shared_mutex> lock(subscribers_mutex);
+        for (SubscriberId id : slow) {
+            remove_locked(id);
+        }
+    }
+    return has_more;
+}
+
+bool ChangeHub::deliver(Subscriber& subscriber, sqlite3_int64 seq, const std::string& message) {
+    // The subscriber's lock orders this send against unsubscribe(), which must not return
+    // while a send to the closed connection is still to come
+    std::lock_guard<std::mutex> lock(subscriber.mutex);
+    if (subscriber.closed) {
+        return true;
+    }
+
+    if (subscriber.count == ring_capacity ||
+        (subscriber.count > 0 && subscriber.pending_bytes + message.size() > MAX_PENDING_BYTES)) {
+        subscriber.closed = true;
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        subscriber.close("slow consumer");
+        return false;
+    }
+
+    subscriber.ring[(subscriber.head + subscriber.count) % ring_capacity] = Sent{seq, message.size()};
+    ++subscriber.count;
+    subscriber.pending_bytes += message.size();
+    delivered.fetch_add(1, std::memory_order_relaxed);
+    subscriber.send(message);
+    return true;
+}
@@ -0,0 +1,145 @@
+#include "connection_pool.h"
+#include "metrics.h"
+#include <atomic>
+#include <iostream>
+
+namespace {
+    const int BUSY_TIMEOUT_MS = 5000;
+
+    const char* CONNECTION_PRAGMAS = R"(
+        PRAGMA journal_mode = WAL;
+        PRAGMA synchronous = NORMAL;
+        PRAGMA temp_store = MEMORY;
+        PRAGMA foreign_keys = ON;
+    )";
+}
+
+ConnectionPool::Lease::Lease(std::unique_lock<std::mutex> lock, Slot* slot)
+    : lock(std::move(lock)), slot(slot), acquired_at(std::chrono::steady_clock::now()) {}
+
+ConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : lock(std::move(other.lock)), slot(other.slot), acquired_at(other.acquired_at) {
+    other.slot = nullptr;
+}
+
+ConnectionPool::Lease& ConnectionPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        record_hold_time();
+        lock = std::move(other.lock);
+        slot = other.slot;
+        acquired_at = other.acquired_at;
+        other.slot = nullptr;
+    }
+    return *this;
+}
+
+ConnectionPool::Lease::~Lease() {
+    record_hold_time();
+}
+
+void ConnectionPool::Lease::record_hold_time() {
+    // Time a request spends holding a connection is its database stage
+    if (slot) {
+        Metrics::global().record_stage(Metrics::Stage::Database, std::chrono::steady_clock::now() - acquired_at);
+    }
+}
+
+sqlite3* ConnectionPool::Lease::get() const {
+    return slot ? slot->handle : nullptr;
+}
+
+Statement ConnectionPool::Lease::prepare(std::string_view sql) {
+    if (!get()) {
+        return Statement();
+    }
+    return slot->statements.prepare(slot->handle, sql);
+}
+
+ConnectionPool::ConnectionPool(const std::string& db_path, size_t size) : db_path(db_path) {
+    if (size == 0) {
+        size = 1;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        slots.push_back(std::make_unique<Slot>());
+    }
+}
+
+ConnectionPool::~ConnectionPool() {
+    close();
+}
+
+sqlite3* ConnectionPool::open_connection(const std::string& db_path) {
+    sqlite3* handle = nullptr;
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+    int rc = sqlite3_open_v2(db_path.c_str(), &handle, flags, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Can't open database: " << (handle ? sqlite3_errmsg(handle) : sqlite3_errstr(rc)) << std::endl;
+        sqlite3_close(handle);
+        return nullptr;
+    }
+
+    sqlite3_busy_timeout(handle, BUSY_TIMEOUT_MS);
+
+    char* err_msg = nullptr;
+    if (sqlite3_exec(handle, CONNECTION_PRAGMAS, nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "Failed to configure connection: " << err_msg << std::endl;
+        sqlite3_free(err_msg);
+        sqlite3_close(handle);
+        return nullptr;
+    }
+
+    return handle;
+}
+
+bool ConnectionPool::open() {
+    for (auto& slot : slots) {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        if (slot->handle) {
+            continue;
+        }
+        slot->handle = open_connection(db_path);
+        if (!slot->handle) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ConnectionPool::close() {
+    for (auto& slot : slots) {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        if (slot->handle) {
+            slot->statements.clear();
+            sqlite3_close(slot->handle);
+            slot->handle = nullptr;
+        }
+    }
+}
+
+size_t ConnectionPool::thread_ordinal() {
+    static std::atomic<size_t> next_ordinal{0};
+    thread_local size_t ordinal = next_ordinal.fetch_add(1, std::memory_order_relaxed);
+    return ordinal;
+}
+
+ConnectionPool::Lease ConnectionPool::acquire() {
+    size_t home = thread_ordinal() % slots.size();
+
+    // Fast path: the slot this thread is pinned to
+    std::unique_lock<std::mutex> lock(slots[home]->mutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+        return Lease(std::move(lock), slots[home].get());
+    }
+
+    // Borrow any idle slot before waiting on our own
+    for (size_t i = 1; i < slots.size(); ++i) {
+        size_t index = (home + i) % slots.size();
+        std::unique_lock<std::mutex> other(slots[index]->mutex, std::try_to_lock);
+        if (other.owns_lock()) {
+            return Lease(std::move(other), slots[index].get());
+        }
+    }
+
+    lock.lock();
+    return Lease(std::move(lock), slots[home].get());
+}
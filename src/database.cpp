@@ -1,53 +1,203 @@
 #include "database.h"
+#include "json_writer.h"
+#include "schema_migrator.h"
 #include <iostream>
 #include <cstring>
+#include <thread>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
 
-Database::Database(const std::string& db_path) : db(nullptr), db_path(db_path) {}
+namespace {
+    // Columns exposed through the API, in SELECT order; id always comes first
+    const std::vector<const char*> USER_COLUMNS = {"id", "username", "email", "created_at"};
+    const std::vector<const char*> TASK_COLUMNS = {"id", "title", "description", "completed", "user_id", "created_at", "updated_at"};
+    
+    // Ordered schema history. Never edit an applied migration; append a new one.
+    const std::vector<Migration> SCHEMA_MIGRATIONS = {
+        {1, "create users and tasks", R"(
+            CREATE TABLE IF NOT EXISTS users (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                username TEXT UNIQUE NOT NULL,
+                email TEXT UNIQUE NOT NULL,
+                password_hash TEXT NOT NULL,
+                created_at DATETIME DEFAULT CURRENT_TIMESTAMP
+            );
+            CREATE TABLE IF NOT EXISTS tasks (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                title TEXT NOT NULL,
+                description TEXT,
+                completed BOOLEAN DEFAULT 0,
+                user_id INTEGER NOT NULL,
+                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                FOREIGN KEY (user_id) REFERENCES users (id) ON DELETE CASCADE
+            );
+        )"},
+        {2, "index tasks by owner and completion", R"(
+            CREATE INDEX IF NOT EXISTS idx_tasks_user_id_id ON tasks (user_id, id);
+            CREATE INDEX IF NOT EXISTS idx_tasks_completed ON tasks (completed);
+        )"},
+        {3, "full-text index over task titles and descriptions", R"(
+            CREATE VIRTUAL TABLE IF NOT EXISTS tasks_fts USING fts5(
+                title, description,
+                content = 'tasks', content_rowid = 'id',
+                tokenize = 'unicode61 remove_diacritics 2',
+                prefix = '2 3'
+            );
+            INSERT INTO tasks_fts (tasks_fts, rank) VALUES ('rank', 'bm25(10.0, 1.0)');
+            INSERT INTO tasks_fts (tasks_fts) VALUES ('rebuild');
+            
+            CREATE TRIGGER IF NOT EXISTS tasks_fts_insert AFTER INSERT ON tasks BEGIN
+                INSERT INTO tasks_fts (rowid, title, description) VALUES (new.id, new.title, new.description);
+            END;
+            CREATE TRIGGER IF NOT EXISTS tasks_fts_delete AFTER DELETE ON tasks BEGIN
+                INSERT INTO tasks_fts (tasks_fts, rowid, title, description) VALUES ('delete', old.id, old.title, old.description);
+            END;
+            CREATE TRIGGER IF NOT EXISTS tasks_fts_update AFTER UPDATE OF title, description ON tasks
+            WHEN old.title IS NOT new.title OR old.description IS NOT new.description BEGIN
+                INSERT INTO tasks_fts (tasks_fts, rowid, title, description) VALUES ('delete', old.id, old.title, old.description);
+                INSERT INTO tasks_fts (rowid, title, description) VALUES (new.id, new.title, new.description);
+            END;
+        )"},
+        {4, "change feed for task sync", R"(
+            -- One row per task: each write replaces it with a fresh seq, so the feed
+            -- holds the latest change of every task and deletes stay as tombstones
+            CREATE TABLE IF NOT EXISTS task_changes (
+                seq INTEGER PRIMARY KEY AUTOINCREMENT,
+                task_id INTEGER NOT NULL UNIQUE,
+                user_id INTEGER NOT NULL,
+                deleted BOOLEAN NOT NULL DEFAULT 0
+            );
+            CREATE INDEX IF NOT EXISTS idx_task_changes_user_seq ON task_changes (user_id, seq);
+            INSERT INTO task_changes (task_id, user_id) SELECT id, user_id FROM tasks ORDER BY id;
+            
+            CREATE TRIGGER IF NOT EXISTS task_changes_insert AFTER INSERT ON tasks BEGIN
+                INSERT OR REPLACE INTO task_changes (task_id, user_id, deleted) VALUES (new.id, new.user_id, 0);
+            END;
+            CREATE TRIGGER IF NOT EXISTS task_changes_update AFTER UPDATE ON tasks BEGIN
+                INSERT OR REPLACE INTO task_changes (task_id, user_id, deleted) VALUES (new.id, new.user_id, 0);
+            END;
+            CREATE TRIGGER IF NOT EXISTS task_changes_delete AFTER DELETE ON tasks BEGIN
+                INSERT OR REPLACE INTO task_changes (task_id, user_id, deleted) VALUES (old.id, old.user_id, 1);
+            END;
+        )"},
+    };
+    
+    // Turns user search text into an FTS5 expression: every word or "quoted phrase"
+    // becomes a quoted string, so FTS5 operators and column filters in the input are
+    // matched literally; a trailing * keeps its meaning as a prefix query.
+    std::string build_match_expression(const std::string& text) {
+        std::string expression;
+        size_t terms = 0;
+        size_t i = 0;
+        while (i < text.size()) {
+            if (std::isspace(static_cast<unsigned char>(text[i]))) {
+                ++i;
+                continue;
+            }
+            
+            std::string term;
+            if (text[i] == '"') {
+                size_t close = text.find('"', i + 1);
+                size_t end = close == std::string::npos ? text.size() : close;
+                term = text.substr(i + 1, end - i - 1);
+                i = close == std::string::npos ? end : end + 1;
+            } else {
+                size_t end = i;
+                while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end])) && text[end] != '"') {
+                    ++end;
+                }
+                term = text.substr(i, end - i);
+                i = end;
+            }
+            
+            bool prefix = false;
+            if (i < text.size() && text[i] == '*') {
+                prefix = true;
+                ++i;
+            }
+            while (!term.empty() && term.back() == '*') {
+                prefix = true;
+                term.pop_back();
+            }
+            if (term.find_first_not_of(" \t\r\n") == std::string::npos) {
+                continue;
+            }
+            
+            if (++terms > SearchQuery::MAX_TERMS) {
+                throw std::invalid_argument("q may contain at most " + std::to_string(SearchQuery::MAX_TERMS) + " terms");
+            }
+            if (!expression.empty()) {
+                expression += ' ';
+            }
+            expression += '"';
+            for (char c : term) {
+                expression += c;
+                if (c == '"') {
+                    expression += '"';
+                }
+            }
+            expression += '"';
+            if (prefix) {
+                expression += '*';
+            }
+        }
+        
+        if (expression.empty()) {
+            throw std::invalid_argument("q must contain at least one search term");
+        }
+        return expression;
+    }
+    
+    void bind_optional_text(sqlite3_stmt* stmt, int index, const std::optional<std::string>& value) {
+        if (value) {
+            sqlite3_bind_text(stmt, index, value->c_str(), -1, SQLITE_STATIC);
+        } else {
+            sqlite3_bind_null(stmt, index);
+        }
+    }
+}
 
-Database::~Database() {
-    if (db) {
-        sqlite3_close(db);
+Database::Database(const std::string& db_path, size_t pool_size, size_t cache_bytes,
+                   size_t write_batch, std::chrono::microseconds write_delay) : db_path(db_path) {
+    if (pool_size == 0) {
+        pool_size = std::max(1u, std::thread::hardware_concurrency());
     }
+    pool = std::make_unique<ConnectionPool>(db_path, pool_size);
+    writer = std::make_unique<WriteQueue>(db_path, write_batch, write_delay);
+    
+    // Tasks are far more numerous than users, so they get most of the budget
+    user_cache = std::make_unique<RowCache>(cache_bytes / 4);
+    task_cache = std::make_unique<RowCache>(cache_bytes - cache_bytes / 4);
+}
+
+Database::~Database() {
+    writer->stop();
+    pool->close();
 }
 
 bool Database::initialize() {
-    int rc = sqlite3_open(db_path.c_str(), &db);
-    if (rc) {
-        std::cerr << "Can't open database: " << sqlite3_errmsg(db) << std::endl;
+    if (!pool->open()) {
         return false;
     }
     
-    return create_tables();
+    // The writer's connection opens after migrations so it never races schema creation
+    return create_tables() && writer->start();
 }
 
 bool Database::create_tables() {
-    const char* create_users_table = R"(
-        CREATE TABLE IF NOT EXISTS users (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            username TEXT UNIQUE NOT NULL,
-            email TEXT UNIQUE NOT NULL,
-            password_hash TEXT NOT NULL,
-            created_at DATETIME DEFAULT CURRENT_TIMESTAMP
-        );
-    )";
-    
-    const char* create_tasks_table = R"(
-        CREATE TABLE IF NOT EXISTS tasks (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            title TEXT NOT NULL,
-            description TEXT,
-            completed BOOLEAN DEFAULT 0,
-            user_id INTEGER NOT NULL,
-            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-            updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-            FOREIGN KEY (user_id) REFERENCES users (id) ON DELETE CASCADE
-        );
-    )";
-    
-    return execute(create_users_table) && execute(create_tasks_table);
+    auto conn = pool->acquire();
+    SchemaMigrator migrator(conn.get());
+    return migrator.migrate(SCHEMA_MIGRATIONS);
 }
 
 bool Database::execute(const std::string& sql) {
+    auto conn = pool->acquire();
+    sqlite3* db = conn.get();
     char* err_msg = nullptr;
     int rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err_msg);
     
@@ -62,257 +212,764 @@ bool Database::execute(const std::string& sql) {
 
 bool Database::create_user(const std::string& username, const std::string& email, const std::string& password_hash) {
     const char* sql = "INSERT INTO users (username, email, password_hash) VALUES (?, ?, ?);";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << std::endl;
-        return false;
-    }
-    
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, email.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, password_hash.c_str(), -1, SQLITE_STATIC);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    return rc == SQLITE_DONE;
-}
-
-nlohmann::json Database::get_user_by_id(int user_id) {
-    const char* sql = "SELECT id, username, email, created_at FROM users WHERE id = ?;";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        return nlohmann::json();
-    }
-    
-    sqlite3_bind_int(stmt, 1, user_id);
-    
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        nlohmann::json user = row_to_json_user(stmt);
-        sqlite3_finalize(stmt);
-        return user;
-    }
-    
-    sqlite3_finalize(stmt);
-    return nlohmann::json();
+    return writer->run([&](WriteQueue::Context& ctx) {
+        auto stmt = ctx.prepare(sql);
+        if (!stmt) {
+            return false;
+        }
+        
+        sqlite3_bind_text(stmt.get(), 1, username.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 2, email.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 3, password_hash.c_str(), -1, SQLITE_STATIC);
+        
+        return sqlite3_step(stmt.get()) == SQLITE_DONE;
+    });
 }
 
 nlohmann::json Database::get_user_by_username(const std::string& username) {
     const char* sql = "SELECT id, username, email, password_hash, created_at FROM users WHERE username = ?;";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = pool->acquire();
+    auto stmt = conn.prepare(sql);
+    if (!stmt) {
         return nlohmann::json();
     }
     
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 1, username.c_str(), -1, SQLITE_STATIC);
     
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (sqlite3_step(stmt.get()) == SQLITE_ROW) {
         nlohmann::json user;
-        user["id"] = sqlite3_column_int(stmt, 0);
-        user["username"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        user["email"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        user["password_hash"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        user["created_at"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        sqlite3_finalize(stmt);
+        user["id"] = sqlite3_column_int(stmt.get(), 0);
+        user["username"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 1));
+        user["email"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 2));
+        user["password_hash"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 3));
+        user["created_at"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 4));
         return user;
     }
     
-    sqlite3_finalize(stmt);
     return nlohmann::json();
 }
 
-std::vector<nlohmann::json> Database::get_all_users() {
-    const char* sql = "SELECT id, username, email, created_at FROM users;";
-    sqlite3_stmt* stmt;
-    std::vector<nlohmann::json> users;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        return users;
-    }
-    
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        users.push_back(row_to_json_user(stmt));
-    }
-    
-    sqlite3_finalize(stmt);
-    return users;
+bool Database::export_users(const PageQuery& query, std::string& out, std::optional<int>& next_cursor) {
+    return export_rows(build_page_sql("users", USER_COLUMNS, query, false), query, std::nullopt, out, next_cursor);
+}
+
+bool Database::write_user_by_id(int user_id, std::string& out) {
+    return write_cached_row(*user_cache, "SELECT id, username, email, created_at FROM users WHERE id = ?;", user_id, 0, out, nullptr);
+}
+
+bool Database::write_all_users(const PageQuery& query, std::string& out, std::optional<int>& next_cursor) {
+    return write_page(build_page_sql("users", USER_COLUMNS, query, false), query, std::nullopt, out, next_cursor);
 }
 
 bool Database::update_user(int user_id, const std::string& username, const std::string& email) {
     const char* sql = "UPDATE users SET username = ?, email = ? WHERE id = ?;";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        return false;
-    }
-    
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, email.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 3, user_id);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    return rc == SQLITE_DONE;
+    return writer->run([&](WriteQueue::Context& ctx) {
+        auto stmt = ctx.prepare(sql);
+        if (!stmt) {
+            return false;
+        }
+        
+        sqlite3_bind_text(stmt.get(), 1, username.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 2, email.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt.get(), 3, user_id);
+        
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+            return false;
+        }
+        ctx.after_commit([this, user_id]() { user_cache->invalidate(user_id); });
+        return true;
+    });
+}
+
+bool Database::update_password_hash(int user_id, const std::string& password_hash) {
+    const char* sql = "UPDATE users SET password_hash = ? WHERE id = ?;";
+    return writer->run([&](WriteQueue::Context& ctx) {
+        auto stmt = ctx.prepare(sql);
+        if (!stmt) {
+            return false;
+        }
+        
+        sqlite3_bind_text(stmt.get(), 1, password_hash.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt.get(), 2, user_id);
+        
+        // password_hash is not part of the cached user JSON, so the row cache stays valid
+        return sqlite3_step(stmt.get()) == SQLITE_DONE;
+    });
 }
 
 bool Database::delete_user(int user_id) {
     const char* sql = "DELETE FROM users WHERE id = ?;";
-    sqlite3_stmt* stmt;
+    return writer->run([&](WriteQueue::Context& ctx) {
+        auto stmt = ctx.prepare(sql);
+        if (!stmt) {
+            return false;
+        }
+        
+        sqlite3_bind_int(stmt.get(), 1, user_id);
+        
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+            return false;
+        }
+        // ON DELETE CASCADE removed the user's tasks as well
+        ctx.after_commit([this, user_id]() {
+            user_cache->invalidate(user_id);
+            task_cache->invalidate_owner(user_id);
+        });
+        return true;
+    });
+}
+
+bool Database::create_task(const std::string& title, const std::string& description, int user_id) {
+    const char* sql = "INSERT INTO tasks (title, description, user_id) VALUES (?, ?, ?);";
+    return writer->run([&](WriteQueue::Context& ctx) {
+        auto stmt = ctx.prepare(sql);
+        if (!stmt) {
+            return false;
+        }
+        
+        sqlite3_bind_text(stmt.get(), 1, title.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 2, description.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt.get(), 3, user_id);
+        
+        return sqlite3_step(stmt.get()) == SQLITE_DONE;
+    });
+}
+
+bool Database::export_tasks(const PageQuery& query, std::optional<int> user_id, std::string& out, std::optional<int>& next_cursor) {
+    return export_rows(build_page_sql("tasks", TASK_COLUMNS, query, user_id.has_value()), query, user_id, out, next_cursor);
+}
+
+bool Database::write_task_by_id(int task_id, std::string& out, int* owner_id) {
+    return write_cached_row(*task_cache, "SELECT id, title, description, completed, user_id, created_at, updated_at FROM tasks WHERE id = ?;", task_id, 4, out, owner_id);
+}
+
+bool Database::write_tasks_by_user(int user_id, const PageQuery& query, std::string& out, std::optional<int>& next_cursor) {
+    return write_page(build_page_sql("tasks", TASK_COLUMNS, query, true), query, user_id, out, next_cursor);
+}
+
+bool Database::write_all_tasks(const PageQuery& query, std::string& out, std::optional<int>& next_cursor) {
+    return write_page(build_page_sql("tasks", TASK_COLUMNS, query, false), query, std::nullopt, out, next_cursor);
+}
+
+bool Database::search_tasks(const SearchQuery& query, std::string& out, std::optional<std::string>& next_cursor) {
+    if (query.text.size() > SearchQuery::MAX_TEXT_LENGTH) {
+        throw std::invalid_argument("q must be at most " + std::to_string(SearchQuery::MAX_TEXT_LENGTH) + " characters");
+    }
+    std::string expression = build_match_expression(query.text);
+    
+    // Cursor of the last row on the previous page: "<rank>:<id>", or "<id>" in Recent order
+    bool by_rank = query.order == SearchQuery::Order::Relevance;
+    std::optional<std::pair<double, int>> after;
+    if (!query.after.empty()) {
+        const char* text = query.after.c_str();
+        size_t colon = by_rank ? query.after.rfind(':') : 0;
+        char* rank_end = nullptr;
+        char* id_end = nullptr;
+        double rank = by_rank ? std::strtod(text, &rank_end) : 0;
+        const char* id_text = by_rank ? text + colon + 1 : text;
+        long id = std::strtol(id_text, &id_end, 10);
+        bool valid = (!by_rank || (colon != std::string::npos && colon > 0 && rank_end == text + colon)) &&
+                     id_end != id_text && *id_end == '\0' && id >= 0 && id <= INT32_MAX;
+        if (!valid) {
+            throw std::invalid_argument("after must be a cursor returned by a previous search");
+        }
+        after.emplace(rank, static_cast<int>(id));
+    }
     
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        return false;
+    int limit = std::clamp(query.limit, 1, PageQuery::MAX_LIMIT);
+    next_cursor.reset();
+    
+    // Relevance is bm25 (title hits weigh 10x) with ties broken by id so the keyset is
+    // total; it scores every match before sorting. Recent walks the index by rowid and
+    // stops after limit rows, so snippets and ranks are only computed for those.
+    std::string sql = "SELECT t.id, t.title, t.description, t.completed, t.user_id, t.created_at, t.updated_at, "
+                      "snippet(tasks_fts, -1, '<mark>', '</mark>', '...', 16) AS snippet, tasks_fts.rank AS rank "
+                      "FROM tasks_fts JOIN tasks t ON t.id = tasks_fts.rowid "
+                      "WHERE tasks_fts MATCH ?";
+    if (query.user_id) {
+        sql += " AND t.user_id = ?";
     }
+    if (after) {
+        sql += by_rank ? " AND (tasks_fts.rank > ? OR (tasks_fts.rank = ? AND t.id > ?))" : " AND tasks_fts.rowid < ?";
+    }
+    sql += by_rank ? " ORDER BY tasks_fts.rank, t.id LIMIT ?;" : " ORDER BY tasks_fts.rowid DESC LIMIT ?;";
     
-    sqlite3_bind_int(stmt, 1, user_id);
+    auto conn = pool->acquire();
+    auto stmt = conn.prepare(sql);
+    if (!stmt) {
+        return false;
+    }
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int index = 1;
+    sqlite3_bind_text(stmt.get(), index++, expression.c_str(), -1, SQLITE_STATIC);
+    if (query.user_id) {
+        sqlite3_bind_int(stmt.get(), index++, *query.user_id);
+    }
+    if (after && by_rank) {
+        sqlite3_bind_double(stmt.get(), index++, after->first);
+        sqlite3_bind_double(stmt.get(), index++, after->first);
+    }
+    if (after) {
+        sqlite3_bind_int(stmt.get(), index++, after->second);
+    }
+    sqlite3_bind_int(stmt.get(), index++, limit + 1);
+    
+    JsonRowWriter writer(stmt.get());
+    int count = 0;
+    double last_rank = 0;
+    int last_id = 0;
+    int rc;
+    out += '[';
+    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+        if (count == limit) {
+            char cursor[48];
+            if (by_rank) {
+                std::snprintf(cursor, sizeof(cursor), "%.17g:%d", last_rank, last_id);
+            } else {
+                std::snprintf(cursor, sizeof(cursor), "%d", last_id);
+            }
+            next_cursor = cursor;
+            rc = SQLITE_DONE;
+            break;
+        }
+        if (count++ > 0) {
+            out += ',';
+        }
+        last_id = sqlite3_column_int(stmt.get(), 0);
+        last_rank = sqlite3_column_double(stmt.get(), 8);
+        writer.write_row(stmt.get(), out);
+    }
+    out += ']';
     
     return rc == SQLITE_DONE;
 }
 
-bool Database::create_task(const std::string& title, const std::string& description, int user_id) {
-    const char* sql = "INSERT INTO tasks (title, description, user_id) VALUES (?, ?, ?);";
-    sqlite3_stmt* stmt;
+bool Database::write_task_changes(const ChangeQuery& query, std::string& out, sqlite3_int64& last_seq, bool& has_more) {
+    bool first = true;
+    out += '[';
+    bool success = visit_task_changes(query, [&](sqlite3_int64, int, const std::string& entry) {
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+        out += entry;
+    }, last_seq, has_more);
+    out += ']';
+    return success;
+}
+
+bool Database::visit_task_changes(const ChangeQuery& query, const ChangeVisitor& visit, sqlite3_int64& last_seq, bool& has_more) {
+    int limit = std::clamp(query.limit, 1, PageQuery::MAX_LIMIT);
+    last_seq = query.since;
+    has_more = false;
+    
+    // Every write commits through the single writer, so seq order is commit order and a
+    // reader can never see seq N+1 before N: resuming from the last seen seq misses nothing
+    std::string sql = "SELECT c.seq, c.task_id, c.user_id, "
+                      "t.id, t.title, t.description, t.completed, t.user_id, t.created_at, t.updated_at "
+                      "FROM task_changes c LEFT JOIN tasks t ON t.id = c.task_id AND c.deleted = 0 "
+                      "WHERE c.seq > ?";
+    if (query.user_id) {
+        sql += " AND c.user_id = ?";
+    }
+    sql += " ORDER BY c.seq LIMIT ?;";
     
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto conn = pool->acquire();
+    auto stmt = conn.prepare(sql);
+    if (!stmt) {
         return false;
     }
     
-    sqlite3_bind_text(stmt, 1, title.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, description.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 3, user_id);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int index = 1;
+    sqlite3_bind_int64(stmt.get(), index++, query.since);
+    if (query.user_id) {
+        sqlite3_bind_int(stmt.get(), index++, *query.user_id);
+    }
+    sqlite3_bind_int(stmt.get(), index++, limit + 1);
+    
+    JsonRowWriter task_writer(stmt.get(), 3);
+    std::string entry;
+    int count = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+        if (count++ == limit) {
+            has_more = true;
+            rc = SQLITE_DONE;
+            break;
+        }
+        
+        sqlite3_int64 seq = sqlite3_column_int64(stmt.get(), 0);
+        entry = "{\"seq\":";
+        entry += std::to_string(seq);
+        entry += ",\"id\":";
+        entry += std::to_string(sqlite3_column_int(stmt.get(), 1));
+        if (sqlite3_column_type(stmt.get(), 3) == SQLITE_NULL) {
+            entry += ",\"deleted\":true,\"task\":null}";
+        } else {
+            entry += ",\"deleted\":false,\"task\":";
+            task_writer.write_row(stmt.get(), entry);
+            entry += '}';
+        }
+        
+        visit(seq, sqlite3_column_int(stmt.get(), 2), entry);
+        last_seq = seq;
+    }
     
     return rc == SQLITE_DONE;
 }
 
-nlohmann::json Database::get_task_by_id(int task_id) {
-    const char* sql = "SELECT id, title, description, completed, user_id, created_at, updated_at FROM tasks WHERE id = ?;";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        return nlohmann::json();
+sqlite3_int64 Database::latest_change_seq() {
+    auto conn = pool->acquire();
+    auto stmt = conn.prepare("SELECT COALESCE(MAX(seq), 0) FROM task_changes;");
+    if (!stmt || sqlite3_step(stmt.get()) != SQLITE_ROW) {
+        return -1;
     }
-    
-    sqlite3_bind_int(stmt, 1, task_id);
-    
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        nlohmann::json task = row_to_json_task(stmt);
-        sqlite3_finalize(stmt);
-        return task;
+    return sqlite3_column_int64(stmt.get(), 0);
+}
+
+WriteOutcome Database::update_task(int task_id, int user_id, const TaskBatchItem& changes, std::string& out) {
+    // One statement: ownership check, partial update and read-back of the new row
+    const char* sql = "UPDATE tasks SET title = COALESCE(?, title), description = COALESCE(?, description), "
+                      "completed = COALESCE(?, completed), updated_at = CURRENT_TIMESTAMP "
+                      "WHERE id = ? AND user_id = ? "
+                      "RETURNING id, title, description, completed, user_id, created_at, updated_at;";
+    WriteOutcome outcome = WriteOutcome::Failed;
+    bool committed = writer->run([&](WriteQueue::Context& ctx) {
+        auto stmt = ctx.prepare(sql);
+        if (!stmt) {
+            return false;
+        }
+        
+        bind_optional_text(stmt.get(), 1, changes.title);
+        bind_optional_text(stmt.get(), 2, changes.description);
+        if (changes.completed) {
+            sqlite3_bind_int(stmt.get(), 3, *changes.completed ? 1 : 0);
+        } else {
+            sqlite3_bind_null(stmt.get(), 3);
+        }
+        sqlite3_bind_int(stmt.get(), 4, task_id);
+        sqlite3_bind_int(stmt.get(), 5, user_id);
+        
+        int rc = sqlite3_step(stmt.get());
+        if (rc == SQLITE_ROW) {
+            JsonRowWriter(stmt.get()).write_row(stmt.get(), out);
+            rc = sqlite3_step(stmt.get());
+        } else if (rc == SQLITE_DONE) {
+            outcome = probe_task_owner(ctx, task_id, user_id);
+            return outcome != WriteOutcome::Failed;
+        }
+        if (rc != SQLITE_DONE) {
+            return false;
+        }
+        
+        outcome = WriteOutcome::Applied;
+        ctx.after_commit([this, task_id]() { task_cache->invalidate(task_id); });
+        return true;
+    });
+    return committed ? outcome : WriteOutcome::Failed;
+}
+
+WriteOutcome Database::delete_task(int task_id, int user_id) {
+    const char* sql = "DELETE FROM tasks WHERE id = ? AND user_id = ?;";
+    WriteOutcome outcome = WriteOutcome::Failed;
+    bool committed = writer->run([&](WriteQueue::Context& ctx) {
+        auto stmt = ctx.prepare(sql);
+        if (!stmt) {
+            return false;
+        }
+        
+        sqlite3_bind_int(stmt.get(), 1, task_id);
+        sqlite3_bind_int(stmt.get(), 2, user_id);
+        
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+            return false;
+        }
+        if (sqlite3_changes(ctx.get()) == 0) {
+            outcome = probe_task_owner(ctx, task_id, user_id);
+            return outcome != WriteOutcome::Failed;
+        }
+        
+        outcome = WriteOutcome::Applied;
+        ctx.after_commit([this, task_id]() { task_cache->invalidate(task_id); });
+        return true;
+    });
+    return committed ? outcome : WriteOutcome::Failed;
+}
+
+WriteOutcome Database::probe_task_owner(WriteQueue::Context& ctx, int task_id, int user_id) {
+    // Only reached when the ownership-scoped statement matched nothing
+    auto stmt = ctx.prepare("SELECT user_id FROM tasks WHERE id = ?;");
+    if (!stmt) {
+        return WriteOutcome::Failed;
     }
     
-    sqlite3_finalize(stmt);
-    return nlohmann::json();
+    sqlite3_bind_int(stmt.get(), 1, task_id);
+    int rc = sqlite3_step(stmt.get());
+    if (rc == SQLITE_DONE) {
+        return WriteOutcome::NotFound;
+    }
+    if (rc != SQLITE_ROW) {
+        return WriteOutcome::Failed;
+    }
+    // Within the writer's transaction an owned row always matches, so any row found here is someone else's
+    return sqlite3_column_int(stmt.get(), 0) != user_id ? WriteOutcome::Forbidden : WriteOutcome::NotFound;
 }
 
-std::vector<nlohmann::json> Database::get_tasks_by_user(int user_id) {
-    const char* sql = "SELECT id, title, description, completed, user_id, created_at, updated_at FROM tasks WHERE user_id = ?;";
-    sqlite3_stmt* stmt;
-    std::vector<nlohmann::json> tasks;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        return tasks;
+bool Database::load_task_owners(WriteQueue::Context& ctx, const std::vector<int>& task_ids, std::unordered_map<int, int>& owners) {
+    // The whole id list goes in as one JSON array, so ownership costs a single query
+    const char* sql = "SELECT id, user_id FROM tasks WHERE id IN (SELECT value FROM json_each(?));";
+    owners.clear();
+    auto stmt = ctx.prepare(sql);
+    if (!stmt) {
+        return false;
     }
     
-    sqlite3_bind_int(stmt, 1, user_id);
-    
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        tasks.push_back(row_to_json_task(stmt));
+    std::string ids = "[";
+    for (size_t i = 0; i < task_ids.size(); ++i) {
+        if (i > 0) {
+            ids += ',';
+        }
+        ids += std::to_string(task_ids[i]);
     }
+    ids += ']';
+    sqlite3_bind_text(stmt.get(), 1, ids.c_str(), static_cast<int>(ids.size()), SQLITE_STATIC);
     
-    sqlite3_finalize(stmt);
-    return tasks;
+    int rc;
+    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+        owners[sqlite3_column_int(stmt.get(), 0)] = sqlite3_column_int(stmt.get(), 1);
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Task owner lookup failed: " << sqlite3_errmsg(ctx.get()) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Database::create_tasks(int user_id, const std::vector<TaskBatchItem>& items, std::vector<TaskBatchResult>& results) {
+    const char* sql = "INSERT INTO tasks (title, description, user_id) VALUES (?, ?, ?);";
+    return writer->run([&](WriteQueue::Context& ctx) {
+        auto stmt = ctx.prepare(sql);
+        if (!stmt) {
+            return false;
+        }
+        
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (results[i].status != 0) {
+                continue;
+            }
+            if (!items[i].title) {
+                results[i] = {400, 0, "Missing required field: title"};
+                continue;
+            }
+            
+            sqlite3_bind_text(stmt.get(), 1, items[i].title->c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt.get(), 2, items[i].description ? items[i].description->c_str() : "", -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt.get(), 3, user_id);
+            if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+                std::cerr << "Batch insert failed: " << sqlite3_errmsg(ctx.get()) << std::endl;
+                return false;
+            }
+            sqlite3_reset(stmt.get());
+            
+            results[i] = {201, static_cast<int>(sqlite3_last_insert_rowid(ctx.get())), ""};
+        }
+        return true;
+    });
+}
+
+bool Database::update_tasks(int user_id, const std::vector<TaskBatchItem>& items, std::vector<TaskBatchResult>& results) {
+    const char* sql = "UPDATE tasks SET title = COALESCE(?, title), description = COALESCE(?, description), "
+                      "completed = COALESCE(?, completed), updated_at = CURRENT_TIMESTAMP "
+                      "WHERE id = ? AND user_id = ?;";
+    return writer->run([&](WriteQueue::Context& ctx) {
+        std::vector<int> task_ids;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (results[i].status == 0) {
+                task_ids.push_back(items[i].id);
+            }
+        }
+        std::unordered_map<int, int> owners;
+        if (!load_task_owners(ctx, task_ids, owners)) {
+            return false;
+        }
+        
+        auto stmt = ctx.prepare(sql);
+        if (!stmt) {
+            return false;
+        }
+        
+        std::vector<int> updated;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (results[i].status != 0) {
+                continue;
+            }
+            const TaskBatchItem& item = items[i];
+            auto owner = owners.find(item.id);
+            if (owner == owners.end()) {
+                results[i] = {404, item.id, "Task not found"};
+                continue;
+            }
+            if (owner->second != user_id) {
+                results[i] = {403, item.id, "Unauthorized to update this task"};
+                continue;
+            }
+            
+            bind_optional_text(stmt.get(), 1, item.title);
+            bind_optional_text(stmt.get(), 2, item.description);
+            if (item.completed) {
+                sqlite3_bind_int(stmt.get(), 3, *item.completed ? 1 : 0);
+            } else {
+                sqlite3_bind_null(stmt.get(), 3);
+            }
+            sqlite3_bind_int(stmt.get(), 4, item.id);
+            sqlite3_bind_int(stmt.get(), 5, user_id);
+            if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+                std::cerr << "Batch update failed: " << sqlite3_errmsg(ctx.get()) << std::endl;
+                return false;
+            }
+            sqlite3_reset(stmt.get());
+            
+            results[i] = {200, item.id, ""};
+            updated.push_back(item.id);
+        }
+        
+        ctx.after_commit([this, updated = std::move(updated)]() {
+            for (int task_id : updated) {
+                task_cache->invalidate(task_id);
+            }
+        });
+        return true;
+    });
+}
+
+bool Database::delete_tasks(int user_id, const std::vector<int>& task_ids, std::vector<TaskBatchResult>& results) {
+    const char* sql = "DELETE FROM tasks WHERE id = ? AND user_id = ?;";
+    return writer->run([&](WriteQueue::Context& ctx) {
+        std::vector<int> pending;
+        for (size_t i = 0; i < task_ids.size(); ++i) {
+            if (results[i].status == 0) {
+                pending.push_back(task_ids[i]);
+            }
+        }
+        std::unordered_map<int, int> owners;
+        if (!load_task_owners(ctx, pending, owners)) {
+            return false;
+        }
+        
+        auto stmt = ctx.prepare(sql);
+        if (!stmt) {
+            return false;
+        }
+        
+        std::vector<int> deleted;
+        for (size_t i = 0; i < task_ids.size(); ++i) {
+            if (results[i].status != 0) {
+                continue;
+            }
+            int task_id = task_ids[i];
+            auto owner = owners.find(task_id);
+            if (owner == owners.end()) {
+                results[i] = {404, task_id, "Task not found"};
+                continue;
+            }
+            if (owner->second != user_id) {
+                results[i] = {403, task_id, "Unauthorized to delete this task"};
+                continue;
+            }
+            
+            sqlite3_bind_int(stmt.get(), 1, task_id);
+            sqlite3_bind_int(stmt.get(), 2, user_id);
+            if (sqlite3_step(stmt.get()) != SQLITE_DONE) {
+                std::cerr << "Batch delete failed: " << sqlite3_errmsg(ctx.get()) << std::endl;
+                return false;
+            }
+            sqlite3_reset(stmt.get());
+            
+            // The same id listed twice is only deleted once
+            if (sqlite3_changes(ctx.get()) == 0) {
+                results[i] = {404, task_id, "Task not found"};
+                continue;
+            }
+            results[i] = {200, task_id, ""};
+            deleted.push_back(task_id);
+        }
+        
+        ctx.after_commit([this, deleted = std::move(deleted)]() {
+            for (int task_id : deleted) {
+                task_cache->invalidate(task_id);
+            }
+        });
+        return true;
+    });
+}
+
+std::string Database::build_page_sql(const char* table, const std::vector<const char*>& columns,
+                                     const PageQuery& query, bool filter_by_user) {
+    std::string sql = "SELECT id";
+    for (const char* column : columns) {
+        if (std::strcmp(column, "id") == 0) {
+            continue;
+        }
+        bool selected = query.fields.empty() ||
+            std::find(query.fields.begin(), query.fields.end(), column) != query.fields.end();
+        if (selected) {
+            sql += ", ";
+            sql += column;
+        }
+    }
+
+    for (const auto& field : query.fields) {
+        bool known = std::any_of(columns.begin(), columns.end(),
+                                 [&field](const char* column) { return field == column; });
+        if (!known) {
+            throw std::invalid_argument("Unknown field: " + field);
+        }
+    }
+
+    sql += " FROM ";
+    sql += table;
+    sql += filter_by_user ? " WHERE user_id = ? AND id > ?" : " WHERE id > ?";
+    sql += " ORDER BY id LIMIT ?;";
+    return sql;
 }
 
-std::vector<nlohmann::json> Database::get_all_tasks() {
-    const char* sql = "SELECT id, title, description, completed, user_id, created_at, updated_at FROM tasks;";
-    sqlite3_stmt* stmt;
-    std::vector<nlohmann::json> tasks;
+bool Database::export_rows(const std::string& sql, const PageQuery& query, std::optional<int> user_id,
+                           std::string& out, std::optional<int>& next_cursor) {
+    next_cursor.reset();
     
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        return tasks;
+    auto conn = pool->acquire();
+    auto stmt = conn.prepare(sql);
+    if (!stmt) {
+        return false;
     }
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        tasks.push_back(row_to_json_task(stmt));
+    int index = 1;
+    if (user_id) {
+        sqlite3_bind_int(stmt.get(), index++, *user_id);
+    }
+    sqlite3_bind_int(stmt.get(), index++, query.after_id);
+    sqlite3_bind_int(stmt.get(), index++, -1);  // LIMIT -1: the byte cap ends the export
+    
+    JsonRowWriter writer(stmt.get());
+    size_t start = out.size();
+    bool first = true;
+    int last_id = 0;
+    int rc;
+    out += '[';
+    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+        if (out.size() - start >= MAX_EXPORT_BYTES) {
+            // Another row exists past the cap; the client continues from the last one sent
+            next_cursor = last_id;
+            rc = SQLITE_DONE;
+            break;
+        }
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+        last_id = sqlite3_column_int(stmt.get(), 0);
+        writer.write_row(stmt.get(), out);
     }
+    out += ']';
     
-    sqlite3_finalize(stmt);
-    return tasks;
+    return rc == SQLITE_DONE;
 }
 
-bool Database::update_task(int task_id, const std::string& title, const std::string& description, bool completed) {
-    const char* sql = "UPDATE tasks SET title = ?, description = ?, completed = ?, updated_at = CURRENT_TIMESTAMP WHERE id = ?;";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+bool Database::write_page(const std::string& sql, const PageQuery& query, std::optional<int> user_id,
+                          std::string& out, std::optional<int>& next_cursor) {
+    int limit = std::clamp(query.limit, 1, PageQuery::MAX_LIMIT);
+    next_cursor.reset();
+    
+    auto conn = pool->acquire();
+    auto stmt = conn.prepare(sql);
+    if (!stmt) {
         return false;
     }
     
-    sqlite3_bind_text(stmt, 1, title.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, description.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 3, completed ? 1 : 0);
-    sqlite3_bind_int(stmt, 4, task_id);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int index = 1;
+    if (user_id) {
+        sqlite3_bind_int(stmt.get(), index++, *user_id);
+    }
+    sqlite3_bind_int(stmt.get(), index++, query.after_id);
+    sqlite3_bind_int(stmt.get(), index++, limit + 1);
+    
+    JsonRowWriter writer(stmt.get());
+    int count = 0;
+    int last_id = 0;
+    int rc;
+    out += '[';
+    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+        if (count == limit) {
+            next_cursor = last_id;
+            rc = SQLITE_DONE;
+            break;
+        }
+        if (count++ > 0) {
+            out += ',';
+        }
+        last_id = sqlite3_column_int(stmt.get(), 0);
+        writer.write_row(stmt.get(), out);
+    }
+    out += ']';
     
     return rc == SQLITE_DONE;
 }
 
-bool Database::delete_task(int task_id) {
-    const char* sql = "DELETE FROM tasks WHERE id = ?;";
-    sqlite3_stmt* stmt;
+bool Database::write_cached_row(RowCache& cache, const char* sql, int id, int owner_column, std::string& out, int* owner_id) {
+    if (auto cached = cache.get(id)) {
+        out += cached->json;
+        if (owner_id) {
+            *owner_id = cached->owner_id;
+        }
+        return true;
+    }
     
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    // Taken before the read so an invalidation racing with it discards our fill
+    uint64_t generation = cache.generation(id);
+    
+    auto conn = pool->acquire();
+    auto stmt = conn.prepare(sql);
+    if (!stmt) {
         return false;
     }
     
-    sqlite3_bind_int(stmt, 1, task_id);
+    sqlite3_bind_int(stmt.get(), 1, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW) {
+        return false;
+    }
     
-    return rc == SQLITE_DONE;
+    size_t start = out.size();
+    JsonRowWriter(stmt.get()).write_row(stmt.get(), out);
+    int owner = sqlite3_column_int(stmt.get(), owner_column);
+    if (owner_id) {
+        *owner_id = owner;
+    }
+    cache.put(id, std::make_shared<RowCache::Entry>(RowCache::Entry{out.substr(start), owner}), generation);
+    return true;
 }
 
-nlohmann::json Database::row_to_json_user(sqlite3_stmt* stmt) {
-    nlohmann::json user;
-    user["id"] = sqlite3_column_int(stmt, 0);
-    user["username"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-    user["email"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-    user["created_at"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-    return user;
-}
-
-nlohmann::json Database::row_to_json_task(sqlite3_stmt* stmt) {
-    nlohmann::json task;
-    task["id"] = sqlite3_column_int(stmt, 0);
-    task["title"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-    task["description"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-    task["completed"] = sqlite3_column_int(stmt, 3) == 1;
-    task["user_id"] = sqlite3_column_int(stmt, 4);
-    task["created_at"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-    task["updated_at"] = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
-    return task;
+nlohmann::json Database::cache_stats() {
+    auto to_json = [](const RowCache::Stats& stats) {
+        return nlohmann::json{
+            {"hits", stats.hits},
+            {"misses", stats.misses},
+            {"evictions", stats.evictions},
+            {"invalidations", stats.invalidations},
+            {"entries", stats.entries},
+            {"bytes", stats.bytes}
+        };
+    };
+    
+    auto writes = writer->stats();
+    return nlohmann::json{
+        {"users", to_json(user_cache->stats())},
+        {"tasks", to_json(task_cache->stats())},
+        {"writes", {
+            {"batches", writes.batches},
+            {"operations", writes.operations},
+            {"failed", writes.failed},
+            {"largest_batch", writes.largest_batch}
+        }}
+    };
 }
@@ -0,0 +1,213 @@
+#include "input_validator.h"
+
+namespace {
+    constexpr std::string_view BEARER_PREFIX = "Bearer";
+    
+    bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+    
+    bool is_alpha(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+    
+    bool is_alnum(char c) {
+        return is_alpha(c) || (c >= '0' && c <= '9');
+    }
+    
+    bool is_local_char(char c) {
+        return is_alnum(c) || c == '.' || c == '_' || c == '%' || c == '+' || c == '-';
+    }
+    
+    bool is_domain_char(char c) {
+        return is_alnum(c) || c == '.' || c == '-';
+    }
+    
+    std::string_view trim(std::string_view text) {
+        while (!text.empty() && is_space(text.front())) {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && is_space(text.back())) {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+    
+    // qvalue = ( "0" [ "." 0*3DIGIT ] ) / ( "1" [ "." 0*3("0") ] ); anything else counts as 0
+    double parse_qvalue(std::string_view text) {
+        if (text.empty() || (text[0] != '0' && text[0] != '1')) {
+            return 0;
+        }
+        double value = text[0] - '0';
+        if (text.size() == 1) {
+            return value;
+        }
+        if (text[1] != '.' || text.size() > 5) {
+            return 0;
+        }
+        double scale = 0.1;
+        for (size_t i = 2; i < text.size(); ++i, scale /= 10) {
+            if (text[i] < '0' || text[i] > '9') {
+                return 0;
+            }
+            value += (text[i] - '0') * scale;
+        }
+        return value > 1 ? 0 : value;
+    }
+}
+
+std::optional<std::string_view> InputValidator::parse_bearer_token(std::string_view header) {
+    if (header.substr(0, BEARER_PREFIX.size()) != BEARER_PREFIX) {
+        return std::nullopt;
+    }
+    
+    size_t pos = BEARER_PREFIX.size();
+    if (pos >= header.size() || !is_space(header[pos])) {
+        return std::nullopt;
+    }
+    while (pos < header.size() && is_space(header[pos])) {
+        ++pos;
+    }
+    
+    std::string_view token = header.substr(pos);
+    if (token.empty()) {
+        return std::nullopt;
+    }
+    
+    // '.' in the original pattern never matched line terminators
+    for (char c : token) {
+        if (c == '\n' || c == '\r') {
+            return std::nullopt;
+        }
+    }
+    
+    return token;
+}
+
+bool InputValidator::is_valid_email(std::string_view email) {
+    size_t at = email.find('@');
+    if (at == 0 || at == std::string_view::npos) {
+        return false;
+    }
+    
+    for (size_t i = 0; i < at; ++i) {
+        if (!is_local_char(email[i])) {
+            return false;
+        }
+    }
+    
+    // '@' is in neither character class, so a second one fails the domain scan
+    std::string_view domain = email.substr(at + 1);
+    for (char c : domain) {
+        if (!is_domain_char(c)) {
+            return false;
+        }
+    }
+    
+    // Only the last dot can start an all-letter TLD; at least one domain character precedes it
+    size_t dot = domain.rfind('.');
+    if (dot == std::string_view::npos || dot == 0 || domain.size() - dot - 1 < 2) {
+        return false;
+    }
+    for (size_t i = dot + 1; i < domain.size(); ++i) {
+        if (!is_alpha(domain[i])) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void InputValidator::parse_quality_list(std::string_view header, const std::function<void(std::string_view value, double q)>& visit) {
+    while (!header.empty()) {
+        size_t comma = header.find(',');
+        std::string_view element = header.substr(0, comma);
+        header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+        
+        size_t semicolon = element.find(';');
+        std::string_view value = trim(element.substr(0, semicolon));
+        if (value.empty()) {
+            continue;
+        }
+        
+        double q = 1;
+        while (semicolon != std::string_view::npos) {
+            element = element.substr(semicolon + 1);
+            semicolon = element.find(';');
+            std::string_view param = trim(element.substr(0, semicolon));
+            if (param.size() >= 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                q = parse_qvalue(trim(param.substr(2)));
+            }
+        }
+        visit(value, q);
+    }
+}
+
+bool InputValidator::equals_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        char x = a[i] >= 'A' && a[i] <= 'Z' ? a[i] - 'A' + 'a' : a[i];
+        char y = b[i] >= 'A' && b[i] <= 'Z' ? b[i] - 'A' + 'a' : b[i];
+        if (x != y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t InputValidator::utf8_sequence_length(std::string_view text) {
+    if (text.empty()) {
+        return 0;
+    }
+    auto byte = [&text](size_t i) { return static_cast<unsigned char>(text[i]); };
+    unsigned char lead = byte(0);
+    if (lead < 0x80) {
+        return 1;
+    }
+    
+    // Allowed range of the second byte narrows per lead byte to exclude overlong
+    // encodings (E0, F0), surrogates (ED) and values past U+10FFFF (F4)
+    size_t length;
+    unsigned char low = 0x80, high = 0xbf;
+    if (lead >= 0xc2 && lead <= 0xdf) {
+        length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        if (lead == 0xe0) low = 0xa0;
+        if (lead == 0xed) high = 0x9f;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        if (lead == 0xf0) low = 0x90;
+        if (lead == 0xf4) high = 0x8f;
+    } else {
+        return 0;
+    }
+    
+    if (text.size() < length || byte(1) < low || byte(1) > high) {
+        return 0;
+    }
+    for (size_t i = 2; i < length; ++i) {
+        if (byte(i) < 0x80 || byte(i) > 0xbf) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+bool InputValidator::is_valid_utf8(std::string_view text) {
+    size_t i = 0;
+    while (i < text.size()) {
+        if (static_cast<unsigned char>(text[i]) < 0x80) {
+            ++i;
+            continue;
+        }
+        size_t length = utf8_sequence_length(text.substr(i));
+        if (length == 0) {
+            return false;
+        }
+        i += length;
+    }
+    return true;
+}
@@ -0,0 +1,114 @@
+#include "json_writer.h"
+#include "input_validator.h"
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    const char HEX_DIGITS[] = "0123456789abcdef";
+    const char REPLACEMENT_CHARACTER[] = "\xef\xbf\xbd";   // U+FFFD
+
+    void append_integer(std::string& out, sqlite3_int64 value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr - digits);
+    }
+
+    void append_double(std::string& out, double value) {
+        char digits[32];
+        int length = std::snprintf(digits, sizeof(digits), "%.17g", value);
+        out.append(digits, length);
+    }
+}
+
+JsonRowWriter::JsonRowWriter(sqlite3_stmt* stmt, int first_column) {
+    int count = sqlite3_column_count(stmt);
+    columns.reserve(count > first_column ? count - first_column : 0);
+    for (int i = first_column; i < count; ++i) {
+        const char* name = sqlite3_column_name(stmt, i);
+        Column column;
+        column.key = i == first_column ? "" : ",";
+        append_string(column.key, name, std::strlen(name));
+        column.key += ':';
+        column.index = i;
+        column.is_boolean = std::strcmp(name, "completed") == 0;
+        columns.push_back(std::move(column));
+    }
+}
+
+void JsonRowWriter::write_row(sqlite3_stmt* stmt, std::string& out) const {
+    out += '{';
+    for (const Column& column : columns) {
+        int index = column.index;
+        out += column.key;
+
+        switch (sqlite3_column_type(stmt, index)) {
+            case SQLITE_INTEGER:
+                if (column.is_boolean) {
+                    out += sqlite3_column_int(stmt, index) == 1 ? "true" : "false";
+                } else {
+                    append_integer(out, sqlite3_column_int64(stmt, index));
+                }
+                break;
+            case SQLITE_FLOAT:
+                append_double(out, sqlite3_column_double(stmt, index));
+                break;
+            case SQLITE_NULL:
+                out += "null";
+                break;
+            default: {
+                const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, index));
+                append_string(out, text, sqlite3_column_bytes(stmt, index));
+                break;
+            }
+        }
+    }
+    out += '}';
+}
+
+void JsonRowWriter::append_string(std::string& out, const char* text, size_t length) {
+    out += '"';
+
+    // Copy runs of safe bytes in one append; only escape what JSON requires
+    size_t run_start = 0;
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x80) {
+            // Stored text is not guaranteed to be UTF-8 (MessagePack bodies are not checked
+            // by the parser), so each byte of a malformed sequence becomes U+FFFD
+            size_t sequence = InputValidator::utf8_sequence_length(std::string_view(text + i, length - i));
+            if (sequence > 0) {
+                i += sequence - 1;
+                continue;
+            }
+            out.append(text + run_start, i - run_start);
+            out.append(REPLACEMENT_CHARACTER, 3);
+            run_start = i + 1;
+            continue;
+        }
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        out.append(text + run_start, i - run_start);
+        run_start = i + 1;
+
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default: {
+                char escape[] = {'\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xF]};
+                out.append(escape, sizeof(escape));
+                break;
+            }
+        }
+    }
+    out.append(text + run_start, length - run_start);
+
+    out += '"';
+}
@@ -3,10 +3,33 @@
 #include <memory>
 #include "database.h"
 #include "api_routes.h"
+#include "auth_service.h"
+#include "server_config.h"
 
-int main() {
-    // Initialize database
-    auto database = std::make_shared<Database>("rest_api.db");
+int main(int argc, char** argv) {
+    // Settings come from an optional JSON file (--config <path> or CONFIG_FILE) and the environment
+    std::string config_path;
+    if (const char* env_config = std::getenv("CONFIG_FILE")) {
+        config_path = env_config;
+    }
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--config") {
+            config_path = argv[i + 1];
+        }
+    }
+    
+    ServerConfig config;
+    if (!ServerConfig::load(config_path, config)) {
+        return 1;
+    }
+    
+    // Threads started from here on (pool, writer, hashing, Crow workers) inherit the CPU set
+    if (!config.apply_cpu_affinity()) {
+        return 1;
+    }
+    
+    auto database = std::make_shared<Database>(config.db_path, config.db_pool_size, config.cache_bytes,
+                                               config.write_batch, config.write_delay);
     if (!database->initialize()) {
         std::cerr << "Failed to initialize database!" << std::endl;
         return 1;
@@ -14,6 +37,10 @@ int main() {
     
     std::cout << "Database initialized successfully!" << std::endl;
     
+    if (config.pbkdf2_iterations > 0) {
+        AuthService::set_pbkdf2_iterations(config.pbkdf2_iterations);
+    }
+    
     // Create Crow application
     crow::SimpleApp app;
     
@@ -21,7 +48,7 @@ int main() {
     app.loglevel(crow::LogLevel::Info);
     
     // Setup API routes
-    APIRoutes api_routes(database);
+    APIRoutes api_routes(database, config);
     api_routes.setup_routes(app);
     
     // Add global CORS middleware
@@ -29,7 +56,7 @@ int main() {
     ([](const crow::request& req, const std::string& path) {
         crow::response res(200);
         res.add_header("Access-Control-Allow-Origin", "*");
-        res.add_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
+        res.add_header("Access-Control-Allow-Methods", "GET, POST, PUT, PATCH, DELETE, OPTIONS");
         res.add_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
         return res;
     });
@@ -52,8 +79,17 @@ int main() {
                 {"POST /api/tasks", "Create task (authenticated)"},
                 {"GET /api/tasks/:id", "Get task by ID"},
                 {"PUT /api/tasks/:id", "Update task (authenticated)"},
+                {"PATCH /api/tasks/:id", "Update only the given task fields (authenticated)"},
                 {"DELETE /api/tasks/:id", "Delete task (authenticated)"},
+                {"POST /api/tasks/batch", "Create tasks in bulk (authenticated)"},
+                {"PUT /api/tasks/batch", "Update tasks in bulk (authenticated)"},
+                {"DELETE /api/tasks/batch", "Delete tasks in bulk (authenticated)"},
                 {"GET /api/users/:id/tasks", "Get tasks by user ID"},
+                {"GET /api/tasks/search?q=", "Full-text search over tasks"},
+                {"GET /api/tasks/changes?since=", "Task changes since a sync cursor"},
+                {"GET /api/ws", "WebSocket push of task changes (subscribe with a token)"},
+                {"GET /api/cache/stats", "Point-lookup cache counters"},
+                {"GET /api/metrics", "Prometheus metrics"},
                 {"GET /api/health", "Health check"}
             }}
         };
@@ -64,17 +100,17 @@ int main() {
         return res;
     });
     
-    // Set port from environment or default to 8080
-    int port = 8080;
-    if (const char* env_port = std::getenv("PORT")) {
-        port = std::atoi(env_port);
-    }
+    int port = config.port;
     
     std::cout << "Starting REST API server on port " << port << "..." << std::endl;
     std::cout << "API Documentation available at: http://localhost:" << port << std::endl;
     
     // Run the app
-    app.port(port).multithreaded().run();
+    // load() has resolved io_threads, so handler_threads() matches what Crow runs
+    app.port(port)
+        .timeout(static_cast<uint8_t>(config.keep_alive_seconds))
+        .concurrency(static_cast<uint16_t>(config.io_threads))
+        .run();
     
     return 0;
 }
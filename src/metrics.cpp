@@ -0,0 +1,282 @@
+#include "metrics.h"
+#include <cstdio>
+
+namespace {
+    const char* STAGE_NAMES[] = {"db", "auth", "serialize"};
+    const double QUANTILES[] = {0.5, 0.99, 0.999};
+    
+    void increment(std::atomic<uint64_t>& counter, uint64_t amount = 1) {
+        // Single writer per counter: a plain load/store pair avoids a locked RMW
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+    
+    void append_number(std::string& out, double value) {
+        char digits[32];
+        int length = std::snprintf(digits, sizeof(digits), "%.9g", value);
+        out.append(digits, length);
+    }
+    
+    void append_header(std::string& out, const char* name, const char* help, const char* type) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+    
+    void append_summary(std::string& out, const char* name, const std::string& labels,
+                        const std::vector<uint64_t>& buckets, uint64_t count, uint64_t sum_nanos) {
+        for (double q : QUANTILES) {
+            out += name;
+            out += '{';
+            out += labels;
+            out += ",quantile=\"";
+            append_number(out, q);
+            out += "\"} ";
+            append_number(out, LatencyHistogram::quantile(buckets, count, q) / 1e9);
+            out += '\n';
+        }
+        out += name;
+        out += "_sum{";
+        out += labels;
+        out += "} ";
+        append_number(out, sum_nanos / 1e9);
+        out += '\n';
+        out += name;
+        out += "_count{";
+        out += labels;
+        out += "} ";
+        out += std::to_string(count);
+        out += '\n';
+    }
+}
+
+size_t LatencyHistogram::bucket_index(uint64_t nanos) {
+    if (nanos < SUB_BUCKETS) {
+        return static_cast<size_t>(nanos);
+    }
+    
+    int exponent = 63 - __builtin_clzll(nanos);
+    size_t index = SUB_BUCKETS + (exponent - 4) * SUB_BUCKETS + ((nanos >> (exponent - 4)) - SUB_BUCKETS);
+    return index < BUCKETS ? index : BUCKETS - 1;
+}
+
+double LatencyHistogram::bucket_midpoint(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return static_cast<double>(index);
+    }
+    
+    size_t exponent = (index - SUB_BUCKETS) / SUB_BUCKETS + 4;
+    size_t sub_bucket = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    double lower = static_cast<double>((SUB_BUCKETS + sub_bucket) << (exponent - 4));
+    double width = static_cast<double>(uint64_t(1) << (exponent - 4));
+    return lower + width / 2;
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+    increment(buckets[bucket_index(nanos)]);
+    increment(count);
+    increment(sum_nanos, nanos);
+}
+
+void LatencyHistogram::merge_into(std::vector<uint64_t>& merged, uint64_t& merged_count, uint64_t& merged_sum) const {
+    merged.resize(BUCKETS, 0);
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        merged[i] += buckets[i].load(std::memory_order_relaxed);
+    }
+    merged_count += count.load(std::memory_order_relaxed);
+    merged_sum += sum_nanos.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::quantile(const std::vector<uint64_t>& buckets, uint64_t count, double q) {
+    if (count == 0) {
+        return 0;
+    }
+    
+    // Buckets and count are read separately, so use the bucket total as the population
+    uint64_t total = 0;
+    for (uint64_t bucket : buckets) {
+        total += bucket;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen > rank) {
+            return bucket_midpoint(i);
+        }
+    }
+    return bucket_midpoint(buckets.size() - 1);
+}
+
+Metrics::Shard::~Shard() {
+    for (auto& route : routes) {
+        delete route.load(std::memory_order_relaxed);
+    }
+}
+
+Metrics& Metrics::global() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Shard& Metrics::local_shard() {
+    // Shards outlive their threads so counts from finished threads stay in the totals
+    thread_local Shard* shard = nullptr;
+    if (!shard) {
+        auto owned = std::make_unique<Shard>();
+        shard = owned.get();
+        std::lock_guard<std::mutex> lock(shards_mutex);
+        shards.push_back(std::move(owned));
+    }
+    return *shard;
+}
+
+size_t Metrics::register_route(const std::string& label) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < route_labels.size(); ++i) {
+        if (route_labels[i] == label) {
+            return i;
+        }
+    }
+    if (route_labels.size() >= MAX_ROUTES) {
+        return NO_ROUTE;
+    }
+    
+    route_labels.push_back(label);
+    return route_labels.size() - 1;
+}
+
+size_t Metrics::status_index(int status) {
+    for (size_t i = 0; i + 1 < TRACKED_STATUSES.size(); ++i) {
+        if (TRACKED_STATUSES[i] == status) {
+            return i;
+        }
+    }
+    return TRACKED_STATUSES.size() - 1;
+}
+
+void Metrics::record_request(size_t route, int status, std::chrono::steady_clock::duration elapsed) {
+    if (route >= MAX_ROUTES) {
+        return;
+    }
+    
+    Shard& shard = local_shard();
+    RouteCounters* counters = shard.routes[route].load(std::memory_order_relaxed);
+    if (!counters) {
+        counters = new RouteCounters();
+        shard.routes[route].store(counters, std::memory_order_release);
+    }
+    
+    increment(counters->statuses[status_index(status)]);
+    counters->latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void Metrics::record_stage(Stage stage, std::chrono::steady_clock::duration elapsed) {
+    local_shard().stages[static_cast<size_t>(stage)].record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void Metrics::add_series(const std::string& name, const std::string& help, const std::string& type,
+                         std::function<double()> value) {
+    add_series(name, std::string(), help, type, std::move(value));
+}
+
+void Metrics::add_series(const std::string& name, const std::string& labels, const std::string& help,
+                         const std::string& type, std::function<double()> value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    series.push_back(Series{name, labels, help, type, std::move(value)});
+}
+
+std::string Metrics::render_prometheus() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t routes = route_labels.size();
+    
+    // Merge every shard per route and per stage
+    std::vector<std::array<uint64_t, TRACKED_STATUSES.size()>> statuses(routes);
+    std::vector<std::vector<uint64_t>> route_buckets(routes);
+    std::vector<uint64_t> route_counts(routes, 0), route_sums(routes, 0);
+    size_t stage_count = static_cast<size_t>(Stage::Count);
+    std::vector<std::vector<uint64_t>> stage_buckets(stage_count);
+    std::vector<uint64_t> stage_counts(stage_count, 0), stage_sums(stage_count, 0);
+    
+    for (auto& status : statuses) {
+        status.fill(0);
+    }
+    std::unique_lock<std::mutex> shards_lock(shards_mutex);
+    for (const auto& shard : shards) {
+        for (size_t r = 0; r < routes; ++r) {
+            const RouteCounters* counters = shard->routes[r].load(std::memory_order_acquire);
+            if (!counters) {
+                continue;
+            }
+            for (size_t s = 0; s < TRACKED_STATUSES.size(); ++s) {
+                statuses[r][s] += counters->statuses[s].load(std::memory_order_relaxed);
+            }
+            counters->latency.merge_into(route_buckets[r], route_counts[r], route_sums[r]);
+        }
+        for (size_t s = 0; s < stage_count; ++s) {
+            shard->stages[s].merge_into(stage_buckets[s], stage_counts[s], stage_sums[s]);
+        }
+    }
+    // Series callbacks may record stages themselves (and so need the shard list)
+    shards_lock.unlock();
+    
+    std::string out;
+    out.reserve(16 * 1024);
+    
+    append_header(out, "api_requests_total", "Requests handled, by route and status code.", "counter");
+    for (size_t r = 0; r < routes; ++r) {
+        for (size_t s = 0; s < TRACKED_STATUSES.size(); ++s) {
+            if (statuses[r][s] == 0) {
+                continue;
+            }
+            out += "api_requests_total{route=\"";
+            out += route_labels[r];
+            out += "\",code=\"";
+            out += TRACKED_STATUSES[s] == 0 ? "other" : std::to_string(TRACKED_STATUSES[s]);
+            out += "\"} ";
+            out += std::to_string(statuses[r][s]);
+            out += '\n';
+        }
+    }
+    
+    append_header(out, "api_request_duration_seconds", "Handler latency by route.", "summary");
+    for (size_t r = 0; r < routes; ++r) {
+        if (route_counts[r] > 0) {
+            append_summary(out, "api_request_duration_seconds", "route=\"" + route_labels[r] + "\"",
+                           route_buckets[r], route_counts[r], route_sums[r]);
+        }
+    }
+    
+    append_header(out, "api_stage_duration_seconds",
+                  "Time inside request stages: db (connection held or group commit), auth, serialize.", "summary");
+    for (size_t s = 0; s < stage_count; ++s) {
+        if (stage_counts[s] > 0) {
+            append_summary(out, "api_stage_duration_seconds", std::string("stage=\"") + STAGE_NAMES[s] + "\"",
+                           stage_buckets[s], stage_counts[s], stage_sums[s]);
+        }
+    }
+    
+    for (size_t i = 0; i < series.size(); ++i) {
+        const Series& entry = series[i];
+        if (i == 0 || series[i - 1].name != entry.name) {
+            append_header(out, entry.name.c_str(), entry.help.c_str(), entry.type.c_str());
+        }
+        out += entry.name;
+        if (!entry.labels.empty()) {
+            out += '{';
+            out += entry.labels;
+            out += '}';
+        }
+        out += ' ';
+        append_number(out, entry.value());
+        out += '\n';
+    }
+    
+    return out;
+}
@@ -0,0 +1,69 @@
+#include "password_hasher.h"
+#include <algorithm>
+
+PasswordHasher::PasswordHasher(size_t thread_count, size_t max_pending) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency() / 2);
+    }
+    this->max_pending = max_pending == 0 ? thread_count : max_pending;
+    
+    workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+PasswordHasher::~PasswordHasher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+bool PasswordHasher::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping || jobs.size() + running >= max_pending) {
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        jobs.push_back(std::move(job));
+    }
+    ready.notify_one();
+    return true;
+}
+
+void PasswordHasher::worker_loop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            ++running;
+        }
+        
+        job();
+        completed.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        --running;
+    }
+}
+
+PasswordHasher::Stats PasswordHasher::stats() const {
+    Stats stats;
+    stats.completed = completed.load(std::memory_order_relaxed);
+    stats.rejected = rejected.load(std::memory_order_relaxed);
+    stats.threads = workers.size();
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.pending = jobs.size();
+    return stats;
+}
@@ -0,0 +1,117 @@
+#include "request_arena.h"
+#include <algorithm>
+
+namespace {
+    std::atomic<uint64_t> blocks_allocated{0};
+    std::atomic<uint64_t> bytes_allocated{0};
+}
+
+RequestArena::Scope::Scope() {
+    ++RequestArena::current().depth;
+}
+
+RequestArena::Scope::~Scope() {
+    RequestArena& arena = RequestArena::current();
+    if (--arena.depth == 0) {
+        arena.reset();
+    }
+}
+
+RequestArena::~RequestArena() {
+    for (const Block& block : blocks) {
+        ::operator delete(block.data);
+    }
+}
+
+RequestArena& RequestArena::current() {
+    thread_local RequestArena arena;
+    return arena;
+}
+
+void* RequestArena::allocate(size_t bytes, size_t alignment) {
+    if (!blocks.empty()) {
+        size_t offset = (used + alignment - 1) & ~(alignment - 1);
+        if (offset + bytes <= blocks.back().size) {
+            used = offset + bytes;
+            return blocks.back().data + offset;
+        }
+    }
+
+    // Blocks come from operator new, so they are aligned for any fundamental type
+    add_block(bytes);
+    used = bytes;
+    return blocks.back().data;
+}
+
+bool RequestArena::owns(const void* p) const {
+    auto address = static_cast<const char*>(p);
+    for (const Block& block : blocks) {
+        if (address >= block.data && address < block.data + block.size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RequestArena::add_block(size_t min_bytes) {
+    size_t size = blocks.empty() ? INITIAL_BLOCK_BYTES : blocks.back().size * 2;
+    size = std::max(size, min_bytes);
+    blocks.push_back(Block{static_cast<char*>(::operator new(size)), size});
+    blocks_allocated.fetch_add(1, std::memory_order_relaxed);
+    bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+}
+
+void RequestArena::reset() {
+    used = 0;
+    if (blocks.empty() || (blocks.size() == 1 && blocks.front().size <= MAX_RETAINED_BYTES)) {
+        return;
+    }
+
+    // The request outgrew the first block: replace the chain with one block that
+    // would have held it all, so the next request like it needs a single block
+    size_t total = 0;
+    for (const Block& block : blocks) {
+        total += block.size;
+        ::operator delete(block.data);
+    }
+    blocks.clear();
+    if (total <= MAX_RETAINED_BYTES) {
+        add_block(total);
+    }
+}
+
+size_t RequestArena::retained_bytes() {
+    size_t total = 0;
+    for (const Block& block : current().blocks) {
+        total += block.size;
+    }
+    return total;
+}
+
+RequestArena::Stats RequestArena::stats() {
+    Stats stats;
+    stats.blocks_allocated = blocks_allocated.load(std::memory_order_relaxed);
+    stats.bytes_allocated = bytes_allocated.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// nlohmann::detail::serializer is internal API, so it is used only with the releases it
+// was checked against (3.10 and 3.11, whose serializer and output_adapter match). Any
+// other version takes the public dump(), which costs a serializer, an indent string and
+// a result string per call.
+#if NLOHMANN_JSON_VERSION_MAJOR == 3 && NLOHMANN_JSON_VERSION_MINOR >= 10 && NLOHMANN_JSON_VERSION_MINOR <= 11
+const std::string& dump_json(const RequestJson& value) {
+    // The serializer is the one dump() uses, bound once to this thread's buffer
+    thread_local std::string buffer;
+    thread_local nlohmann::detail::serializer<RequestJson> serializer(nlohmann::detail::output_adapter<char>(buffer), ' ');
+    buffer.clear();
+    serializer.dump(value, false, false, 0);
+    return buffer;
+}
+#else
+const std::string& dump_json(const RequestJson& value) {
+    thread_local std::string buffer;
+    buffer = value.dump();
+    return buffer;
+}
+#endif
@@ -0,0 +1,143 @@
+#include "response_cache.h"
+#include <mutex>
+
+namespace {
+    // Owners with a remembered invalidation; past this the map is reset and
+    // in-flight fills of every owner are refused once, as a global bump would
+    const size_t MAX_INVALIDATED_OWNERS = 4096;
+}
+
+ResponseCache::ResponseCache(size_t max_bytes) : max_bytes(max_bytes) {}
+
+size_t ResponseCache::entry_bytes(const std::string& key, const Entry& entry) {
+    return key.size() + entry.etag.size() + entry.body.size() + entry.content_encoding.size() + entry.content_type.size();
+}
+
+std::shared_ptr<const ResponseCache::Entry> ResponseCache::get(const std::string& key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = entries.find(key);
+    return it == entries.end() ? nullptr : it->second;
+}
+
+void ResponseCache::put(const std::string& key, std::shared_ptr<const Entry> entry, uint64_t generation) {
+    size_t size = entry_bytes(key, *entry);
+    if (size > max_bytes) {
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    // A write to this owner since the fill began may not be reflected in the body
+    auto invalidated = invalidated_at.find(entry->owner_id);
+    if (generation < invalidated_floor || (invalidated != invalidated_at.end() && invalidated->second > generation)) {
+        return;
+    }
+
+    int owner_id = entry->owner_id;
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        bytes -= entry_bytes(key, *it->second);
+        if (it->second->owner_id != owner_id) {
+            owner_keys[it->second->owner_id].erase(key);
+        }
+        it->second = std::move(entry);
+    } else {
+        entries.emplace(key, std::move(entry));
+        insertion_order.push_back(key);
+    }
+    owner_keys[owner_id].insert(key);
+    bytes += size;
+
+    while (bytes > max_bytes && !insertion_order.empty()) {
+        auto victim = entries.find(insertion_order.front());
+        if (victim != entries.end()) {
+            erase_locked(victim);
+        }
+        insertion_order.pop_front();
+    }
+
+    // Keys of invalidated entries linger in the FIFO; compact once they dominate
+    if (insertion_order.size() > 2 * entries.size() + 64) {
+        std::deque<std::string> live;
+        for (auto& queued : insertion_order) {
+            if (entries.count(queued)) {
+                live.push_back(std::move(queued));
+            }
+        }
+        insertion_order.swap(live);
+    }
+}
+
+void ResponseCache::invalidate_owner(int owner_id) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    uint64_t generation = current_generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+    if (invalidated_at.size() >= MAX_INVALIDATED_OWNERS && !invalidated_at.count(owner_id)) {
+        invalidated_at.clear();
+        invalidated_floor = generation;
+    }
+    invalidated_at[owner_id] = generation;
+
+    auto keys = owner_keys.find(owner_id);
+    if (keys == owner_keys.end()) {
+        return;
+    }
+    for (const auto& key : keys->second) {
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            bytes -= entry_bytes(it->first, *it->second);
+            entries.erase(it);
+        }
+    }
+    owner_keys.erase(keys);
+}
+
+void ResponseCache::erase_locked(std::unordered_map<std::string, std::shared_ptr<const Entry>>::iterator it) {
+    auto keys = owner_keys.find(it->second->owner_id);
+    if (keys != owner_keys.end()) {
+        keys->second.erase(it->first);
+        if (keys->second.empty()) {
+            owner_keys.erase(keys);
+        }
+    }
+    bytes -= entry_bytes(it->first, *it->second);
+    entries.erase(it);
+}
+
+std::string ResponseCache::make_etag(const std::string& body) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : body) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+
+    static const char digits[] = "0123456789abcdef";
+    std::string etag(18, '"');
+    for (int i = 0; i < 16; ++i) {
+        etag[16 - i] = digits[(hash >> (i * 4)) & 0xF];
+    }
+    return etag;
+}
+
+bool ResponseCache::etag_matches(const std::string& if_none_match, const std::string& etag) {
+    size_t pos = 0;
+    while (pos < if_none_match.size()) {
+        size_t end = if_none_match.find(',', pos);
+        if (end == std::string::npos) {
+            end = if_none_match.size();
+        }
+
+        size_t start = if_none_match.find_first_not_of(" \t", pos);
+        size_t stop = if_none_match.find_last_not_of(" \t", end - 1);
+        if (start != std::string::npos && start < end && stop >= start) {
+            std::string candidate = if_none_match.substr(start, stop - start + 1);
+            // If-None-Match uses weak comparison, so a W/ prefix is ignored
+            if (candidate.compare(0, 2, "W/") == 0) {
+                candidate.erase(0, 2);
+            }
+            if (candidate == "*" || candidate == etag) {
+                return true;
+            }
+        }
+        pos = end + 1;
+    }
+    return false;
+}
@@ -0,0 +1,190 @@
+#include "response_compressor.h"
+#include "input_validator.h"
+#include <algorithm>
+#include <climits>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+    // A deflate stream keeps its window and hash tables between requests; deflateReset
+    // is far cheaper than the allocation deflateInit2 does
+    struct ZlibContext {
+        z_stream stream{};
+        int level = -1;     // -1 = not initialized
+
+        ~ZlibContext() {
+            if (level >= 0) {
+                deflateEnd(&stream);
+            }
+        }
+    };
+
+    struct ThreadContexts {
+        ZlibContext gzip;
+        ZlibContext deflate;
+#ifdef HAVE_ZSTD
+        ZSTD_CCtx* zstd = nullptr;
+#endif
+        std::string buffer;     // output; swapped with the body, so it keeps the larger capacity up to MAX_RETAINED_BYTES
+
+        ~ThreadContexts() {
+#ifdef HAVE_ZSTD
+            ZSTD_freeCCtx(zstd);
+#endif
+        }
+    };
+
+    ThreadContexts& thread_contexts() {
+        thread_local ThreadContexts contexts;
+        return contexts;
+    }
+}
+
+ResponseCompressor::ResponseCompressor(const Config& config) : config(config) {}
+
+ResponseCompressor::Encoding ResponseCompressor::negotiate(const std::string& accept_encoding) const {
+    if (!config.enabled || accept_encoding.empty()) {
+        return Encoding::Identity;
+    }
+
+    // q-values per coding; -1 = not listed, which means the "*" value if there is one
+    double gzip = -1, deflate = -1, zstd = -1, any = -1;
+    InputValidator::parse_quality_list(accept_encoding, [&](std::string_view coding, double q) {
+        if (InputValidator::equals_ignore_case(coding, "gzip") || InputValidator::equals_ignore_case(coding, "x-gzip")) {
+            gzip = q;
+        } else if (InputValidator::equals_ignore_case(coding, "deflate")) {
+            deflate = q;
+        } else if (InputValidator::equals_ignore_case(coding, "zstd")) {
+            zstd = q;
+        } else if (coding == "*") {
+            any = q;
+        }
+    });
+
+    auto resolve = [any](double q) { return q < 0 ? std::max(any, 0.0) : q; };
+    gzip = resolve(gzip);
+    deflate = resolve(deflate);
+    zstd = zstd_available() ? resolve(zstd) : 0;
+
+    // Ties go to the better ratio for the CPU spent
+    double best = std::max({gzip, deflate, zstd});
+    if (best <= 0) {
+        return Encoding::Identity;
+    }
+    if (zstd == best) {
+        return Encoding::Zstd;
+    }
+    return gzip == best ? Encoding::Gzip : Encoding::Deflate;
+}
+
+bool ResponseCompressor::compress(Encoding encoding, std::string& body) {
+    if (encoding == Encoding::Identity || body.size() < config.min_bytes || body.size() > UINT_MAX) {
+        return false;
+    }
+
+    std::string& out = thread_contexts().buffer;
+    bool success = encoding == Encoding::Zstd ? zstd_into(body, out) : deflate_into(encoding, body, out);
+    success = success && out.size() < body.size();
+    if (success) {
+        compressed.fetch_add(1, std::memory_order_relaxed);
+        bytes_in.fetch_add(body.size(), std::memory_order_relaxed);
+        bytes_out.fetch_add(out.size(), std::memory_order_relaxed);
+        body.swap(out);
+    }
+
+    // After an export the buffer holds its uncompressed body (or its worst-case bound);
+    // every worker keeping one would pin up to Database::MAX_EXPORT_BYTES each
+    if (out.capacity() > MAX_RETAINED_BYTES) {
+        std::string().swap(out);
+    }
+    return success;
+}
+
+size_t ResponseCompressor::retained_bytes() {
+    return thread_contexts().buffer.capacity();
+}
+
+bool ResponseCompressor::deflate_into(Encoding encoding, const std::string& in, std::string& out) const {
+    ZlibContext& context = encoding == Encoding::Gzip ? thread_contexts().gzip : thread_contexts().deflate;
+    z_stream& stream = context.stream;
+
+    if (context.level != config.level) {
+        if (context.level >= 0) {
+            deflateEnd(&stream);
+        }
+        // windowBits 15 gives the zlib format HTTP calls deflate; +16 adds the gzip wrapper
+        int window_bits = encoding == Encoding::Gzip ? 15 + 16 : 15;
+        stream = z_stream{};
+        if (deflateInit2(&stream, config.level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            context.level = -1;
+            return false;
+        }
+        context.level = config.level;
+    } else if (deflateReset(&stream) != Z_OK) {
+        return false;
+    }
+
+    // Sized for the worst case up front, so deflate runs once with Z_FINISH
+    out.resize(deflateBound(&stream, static_cast<uLong>(in.size())));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    stream.avail_in = static_cast<uInt>(in.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+        return false;
+    }
+    out.resize(stream.total_out);
+    return true;
+}
+
+bool ResponseCompressor::zstd_into(const std::string& in, std::string& out) const {
+#ifdef HAVE_ZSTD
+    ThreadContexts& contexts = thread_contexts();
+    if (!contexts.zstd) {
+        contexts.zstd = ZSTD_createCCtx();
+        if (!contexts.zstd) {
+            return false;
+        }
+    }
+
+    out.resize(ZSTD_compressBound(in.size()));
+    size_t written = ZSTD_compressCCtx(contexts.zstd, &out[0], out.size(), in.data(), in.size(), config.zstd_level);
+    if (ZSTD_isError(written)) {
+        return false;
+    }
+    out.resize(written);
+    return true;
+#else
+    (void)in;
+    (void)out;
+    return false;
+#endif
+}
+
+const char* ResponseCompressor::encoding_name(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::Gzip: return "gzip";
+        case Encoding::Deflate: return "deflate";
+        case Encoding::Zstd: return "zstd";
+        default: return "identity";
+    }
+}
+
+bool ResponseCompressor::zstd_available() {
+#ifdef HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+ResponseCompressor::Stats ResponseCompressor::stats() const {
+    Stats stats;
+    stats.compressed = compressed.load(std::memory_order_relaxed);
+    stats.bytes_in = bytes_in.load(std::memory_order_relaxed);
+    stats.bytes_out = bytes_out.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,158 @@
+#include "row_cache.h"
+#include <mutex>
+
+namespace {
+    // Rough per-entry bookkeeping (map node, control block, ring slot)
+    const size_t ENTRY_OVERHEAD_BYTES = 96;
+}
+
+RowCache::RowCache(size_t max_bytes, size_t shard_count) {
+    if (shard_count == 0) {
+        shard_count = 1;
+    }
+    max_bytes_per_shard = max_bytes / shard_count;
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+RowCache::Shard& RowCache::shard_for(int id) const {
+    // Multiplicative hash so sequential ids spread across shards
+    uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(id)) * 0x9E3779B97F4A7C15ULL;
+    return *shards[(hash >> 32) % shards.size()];
+}
+
+size_t RowCache::entry_bytes(const Entry& entry) {
+    return entry.json.size() + ENTRY_OVERHEAD_BYTES;
+}
+
+std::shared_ptr<const RowCache::Entry> RowCache::get(int id) {
+    Shard& shard = shard_for(id);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto it = shard.slots.find(id);
+    if (it == shard.slots.end()) {
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    it->second.referenced.store(true, std::memory_order_relaxed);
+    shard.hits.fetch_add(1, std::memory_order_relaxed);
+    return it->second.entry;
+}
+
+uint64_t RowCache::generation(int id) const {
+    return shard_for(id).generation.load(std::memory_order_acquire);
+}
+
+void RowCache::put(int id, std::shared_ptr<const Entry> entry, uint64_t generation) {
+    if (!entry || entry_bytes(*entry) > max_bytes_per_shard) {
+        return;
+    }
+
+    Shard& shard = shard_for(id);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (shard.generation.load(std::memory_order_relaxed) != generation) {
+        return;
+    }
+
+    auto it = shard.slots.find(id);
+    if (it != shard.slots.end()) {
+        shard.bytes -= entry_bytes(*it->second.entry);
+        it->second.entry = std::move(entry);
+        shard.bytes += entry_bytes(*it->second.entry);
+        it->second.referenced.store(true, std::memory_order_relaxed);
+    } else {
+        auto& slot = shard.slots[id];
+        slot.entry = std::move(entry);
+        slot.ring_index = shard.ring.size();
+        shard.ring.push_back(id);
+        shard.bytes += entry_bytes(*slot.entry);
+    }
+
+    evict_locked(shard);
+}
+
+void RowCache::invalidate(int id) {
+    Shard& shard = shard_for(id);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.generation.fetch_add(1, std::memory_order_release);
+
+    auto it = shard.slots.find(id);
+    if (it != shard.slots.end()) {
+        erase_locked(shard, it);
+        shard.invalidations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void RowCache::invalidate_owner(int owner_id) {
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard->mutex);
+        shard->generation.fetch_add(1, std::memory_order_release);
+
+        for (auto it = shard->slots.begin(); it != shard->slots.end();) {
+            auto next = std::next(it);
+            if (it->second.entry->owner_id == owner_id) {
+                erase_locked(*shard, it);
+                shard->invalidations.fetch_add(1, std::memory_order_relaxed);
+            }
+            it = next;
+        }
+    }
+}
+
+void RowCache::clear() {
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard->mutex);
+        shard->generation.fetch_add(1, std::memory_order_release);
+        shard->slots.clear();
+        shard->ring.clear();
+        shard->hand = 0;
+        shard->bytes = 0;
+    }
+}
+
+void RowCache::erase_locked(Shard& shard, std::unordered_map<int, Slot>::iterator it) {
+    size_t index = it->second.ring_index;
+    int moved_id = shard.ring.back();
+    shard.ring[index] = moved_id;
+    shard.ring.pop_back();
+    if (moved_id != it->first) {
+        shard.slots[moved_id].ring_index = index;
+    }
+
+    shard.bytes -= entry_bytes(*it->second.entry);
+    shard.slots.erase(it);
+}
+
+void RowCache::evict_locked(Shard& shard) {
+    while (shard.bytes > max_bytes_per_shard && !shard.ring.empty()) {
+        if (shard.hand >= shard.ring.size()) {
+            shard.hand = 0;
+        }
+
+        auto it = shard.slots.find(shard.ring[shard.hand]);
+        if (it->second.referenced.exchange(false, std::memory_order_relaxed)) {
+            ++shard.hand;
+            continue;
+        }
+
+        // The last ring entry moves into the hand's position, so the hand stays put
+        erase_locked(shard, it);
+        shard.evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+RowCache::Stats RowCache::stats() const {
+    Stats stats;
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        stats.hits += shard->hits.load(std::memory_order_relaxed);
+        stats.misses += shard->misses.load(std::memory_order_relaxed);
+        stats.evictions += shard->evictions.load(std::memory_order_relaxed);
+        stats.invalidations += shard->invalidations.load(std::memory_order_relaxed);
+        stats.entries += shard->slots.size();
+        stats.bytes += shard->bytes;
+    }
+    return stats;
+}
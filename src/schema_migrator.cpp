@@ -0,0 +1,81 @@
+#include "schema_migrator.h"
+#include <iostream>
+
+bool SchemaMigrator::migrate(const std::vector<Migration>& migrations) {
+    const char* create_version_table = R"(
+        CREATE TABLE IF NOT EXISTS schema_version (
+            version INTEGER PRIMARY KEY,
+            description TEXT NOT NULL,
+            applied_at DATETIME DEFAULT CURRENT_TIMESTAMP
+        );
+    )";
+    
+    if (!exec(create_version_table)) {
+        return false;
+    }
+    
+    int version = current_version();
+    for (const auto& migration : migrations) {
+        if (migration.version <= version) {
+            continue;
+        }
+        if (!apply(migration)) {
+            std::cerr << "Migration " << migration.version << " (" << migration.description << ") failed" << std::endl;
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+int SchemaMigrator::current_version() {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT COALESCE(MAX(version), 0) FROM schema_version;", -1, &stmt, nullptr) != SQLITE_OK) {
+        return -1;
+    }
+    
+    int version = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+bool SchemaMigrator::exec(const char* sql) {
+    char* err_msg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "SQL error: " << err_msg << std::endl;
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+bool SchemaMigrator::apply(const Migration& migration) {
+    if (!exec("BEGIN IMMEDIATE;")) {
+        return false;
+    }
+    
+    // Another process may have applied it while we waited for the write lock
+    if (current_version() >= migration.version) {
+        return exec("COMMIT;");
+    }
+    
+    bool success = exec(migration.sql);
+    if (success) {
+        sqlite3_stmt* stmt;
+        success = sqlite3_prepare_v2(db, "INSERT INTO schema_version (version, description) VALUES (?, ?);", -1, &stmt, nullptr) == SQLITE_OK;
+        if (success) {
+            sqlite3_bind_int(stmt, 1, migration.version);
+            sqlite3_bind_text(stmt, 2, migration.description, -1, SQLITE_STATIC);
+            success = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_finalize(stmt);
+        }
+    }
+    
+    if (!success) {
+        exec("ROLLBACK;");
+        return false;
+    }
+    
+    std::cout << "Applied migration " << migration.version << ": " << migration.description << std::endl;
+    return exec("COMMIT;");
+}
@@ -0,0 +1,310 @@
+#include "server_config.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+    const long CPU_LIMIT = 1024;     // CPUs a fixed-size cpu_set_t can hold
+
+    // The environment variable if set, else the config file key of the same name in lower case
+    std::optional<std::string> setting(const nlohmann::json& file, const std::string& name) {
+        if (const char* env = std::getenv(name.c_str())) {
+            return std::string(env);
+        }
+
+        std::string key = name;
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+        auto it = file.find(key);
+        if (it == file.end() || it->is_null()) {
+            return std::nullopt;
+        }
+        if (it->is_string()) {
+            return it->get<std::string>();
+        }
+        if (it->is_boolean()) {
+            return std::string(it->get<bool>() ? "1" : "0");
+        }
+        return it->dump();
+    }
+
+    bool parse_number(const std::string& name, const std::string& text, long long min, long long max, long long& out) {
+        char* end = nullptr;
+        long long value = std::strtoll(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0' || value < min || value > max) {
+            std::cerr << "Invalid " << name << ": " << text << std::endl;
+            return false;
+        }
+        out = value;
+        return true;
+    }
+
+    template <typename T>
+    bool read_number(const nlohmann::json& file, const std::string& name, long long min, long long max, T& out) {
+        auto text = setting(file, name);
+        long long value;
+        if (!text) {
+            return true;
+        }
+        if (!parse_number(name, *text, min, max, value)) {
+            return false;
+        }
+        out = static_cast<T>(value);
+        return true;
+    }
+
+    // Leaves out unset when the setting is absent, so 0 can mean something other than "default"
+    template <typename T>
+    bool read_number(const nlohmann::json& file, const std::string& name, long long min, long long max, std::optional<T>& out) {
+        T value{};
+        if (!setting(file, name)) {
+            return true;
+        }
+        if (!read_number(file, name, min, max, value)) {
+            return false;
+        }
+        out = value;
+        return true;
+    }
+
+    bool read_flag(const nlohmann::json& file, const std::string& name, bool& out) {
+        auto text = setting(file, name);
+        if (text) {
+            out = *text == "1" || *text == "true" || *text == "yes" || *text == "on";
+        }
+        return true;
+    }
+
+    // "label=limit;label=limit" from the environment, or {"label": limit} in the file
+    bool read_route_limits(const nlohmann::json& file, std::map<std::string, size_t>& limits) {
+        const char* env = std::getenv("ROUTE_CONCURRENCY");
+        if (!env) {
+            auto it = file.find("route_concurrency");
+            if (it == file.end() || !it->is_object()) {
+                return it == file.end() || it->is_null();
+            }
+            for (const auto& [label, limit] : it->items()) {
+                if (!limit.is_number_unsigned()) {
+                    std::cerr << "Invalid route_concurrency limit for " << label << std::endl;
+                    return false;
+                }
+                limits[label] = limit.get<size_t>();
+            }
+            return true;
+        }
+
+        std::string text = env;
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = text.find(';', start);
+            std::string entry = text.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            size_t equals = entry.rfind('=');
+            long long value;
+            if (equals == std::string::npos ||
+                !parse_number("ROUTE_CONCURRENCY", entry.substr(equals + 1), 0, 1 << 20, value)) {
+                return false;
+            }
+            limits[entry.substr(0, equals)] = static_cast<size_t>(value);
+            if (end == std::string::npos) {
+                break;
+            }
+            start = end + 1;
+        }
+        return true;
+    }
+}
+
+bool ServerConfig::load(const std::string& path, ServerConfig& config) {
+    nlohmann::json file = nlohmann::json::object();
+    if (!path.empty()) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Can't open config file: " << path << std::endl;
+            return false;
+        }
+        try {
+            file = nlohmann::json::parse(in);
+        } catch (const nlohmann::json::exception& e) {
+            std::cerr << "Invalid config file " << path << ": " << e.what() << std::endl;
+            return false;
+        }
+        if (!file.is_object()) {
+            std::cerr << "Config file must hold a JSON object: " << path << std::endl;
+            return false;
+        }
+    }
+
+    const long long MAX_COUNT = 1 << 20;
+    size_t cache_mb = config.cache_bytes / (1024 * 1024);
+    long long write_delay_us = config.write_delay.count();
+    long long admission_wait_ms = config.admission.max_wait.count();
+    bool ok = read_number(file, "PORT", 1, 65535, config.port) &&
+              read_number(file, "IO_THREADS", 0, MAX_IO_THREADS, config.io_threads) &&
+              read_number(file, "DB_POOL_SIZE", 0, MAX_COUNT, config.db_pool_size) &&
+              read_number(file, "HASH_THREADS", 0, MAX_COUNT, config.hash_threads) &&
+              read_number(file, "HASH_QUEUE", 0, MAX_COUNT, config.hash_queue) &&
+              read_number(file, "KEEP_ALIVE_SECONDS", 1, 255, config.keep_alive_seconds) &&
+              read_number(file, "MAX_BODY_BYTES", 1, INT32_MAX, config.max_body_bytes) &&
+              read_number(file, "ROW_CACHE_MB", 0, MAX_COUNT, cache_mb) &&
+              read_number(file, "WRITE_BATCH_SIZE", 1, MAX_COUNT, config.write_batch) &&
+              read_number(file, "WRITE_BATCH_DELAY_US", 0, 10000000, write_delay_us) &&
+              read_number(file, "PBKDF2_ITERATIONS", 0, INT32_MAX, config.pbkdf2_iterations) &&
+              read_number(file, "PUSH_RING_CAPACITY", 1, MAX_COUNT, config.push_ring_capacity) &&
+              read_number(file, "COMPRESSION_MIN_BYTES", 0, INT32_MAX, config.compression.min_bytes) &&
+              read_number(file, "COMPRESSION_LEVEL", 1, 9, config.compression.level) &&
+              read_number(file, "ZSTD_LEVEL", 1, 19, config.compression.zstd_level) &&
+              read_flag(file, "COMPRESSION", config.compression.enabled) &&
+              read_number(file, "ADMISSION_CAPACITY", 0, MAX_COUNT, config.admission.capacity) &&
+              read_number(file, "ADMISSION_QUEUE", 0, MAX_COUNT, config.admission.max_queued) &&
+              read_number(file, "ADMISSION_WAIT_MS", 0, 600000, admission_wait_ms) &&
+              read_route_limits(file, config.admission.route_limits) &&
+              read_flag(file, "PIN_WORKERS", config.pin_workers);
+    if (!ok) {
+        return false;
+    }
+
+    if (auto db_path = setting(file, "DB_PATH")) {
+        config.db_path = *db_path;
+    }
+    if (auto cpus = setting(file, "CPU_AFFINITY")) {
+        if (!parse_cpu_list(*cpus, config.cpu_affinity)) {
+            std::cerr << "Invalid CPU_AFFINITY: " << *cpus << std::endl;
+            return false;
+        }
+    }
+
+    if (config.pin_workers && config.cpu_affinity.empty()) {
+        for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+            config.cpu_affinity.push_back(static_cast<int>(cpu));
+        }
+    }
+
+    // One thread only accepts connections and at least one handler must stay free of
+    // password hashing, so fewer than MIN_IO_THREADS can't be configured safely
+    if (config.io_threads == 0) {
+        config.io_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), MIN_IO_THREADS, MAX_IO_THREADS);
+    } else if (config.io_threads < MIN_IO_THREADS) {
+        std::cerr << "IO_THREADS must be at least " << MIN_IO_THREADS << ": one accepts connections and "
+                  << "password hashing must leave a handler thread free" << std::endl;
+        return false;
+    }
+
+    config.cache_bytes = cache_mb * 1024 * 1024;
+    config.write_delay = std::chrono::microseconds(write_delay_us);
+    config.admission.max_wait = std::chrono::milliseconds(admission_wait_ms);
+    config.admission.worker_threads = config.handler_threads();
+    config.admission = AdmissionController::resolve(config.admission);
+
+    // A register/login handler blocks its worker until the hash is done, so only a quarter
+    // of the handler threads may wait on hashing; a login burst beyond that gets 503
+    size_t handlers = config.handler_threads();
+    if (config.hash_queue == 0) {
+        config.hash_queue = std::max<size_t>(1, handlers / 4);
+    }
+    if (config.hash_queue >= handlers) {
+        std::cerr << "HASH_QUEUE " << config.hash_queue << " would let password hashing occupy all "
+                  << handlers << " handler threads; set it below that" << std::endl;
+        return false;
+    }
+    if (config.hash_threads == 0) {
+        config.hash_threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency() / 2), config.hash_queue);
+    }
+
+    // Queued requests block their handler thread as running ones do; the defaults always fit
+    size_t admitted = config.admission.capacity + *config.admission.max_queued;
+    if (admitted + AdmissionController::RESERVED_THREADS > handlers) {
+        std::cerr << "ADMISSION_CAPACITY + ADMISSION_QUEUE (" << admitted << ") must leave "
+                  << AdmissionController::RESERVED_THREADS << " of the " << handlers
+                  << " handler threads for health checks" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+size_t ServerConfig::handler_threads() const {
+    size_t threads = io_threads > 0 ? io_threads : std::max<size_t>(MIN_IO_THREADS, std::thread::hardware_concurrency());
+    return threads > 1 ? threads - 1 : 1;
+}
+
+bool ServerConfig::parse_cpu_list(const std::string& text, std::vector<int>& cpus) {
+    cpus.clear();
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find(',', start);
+        std::string range = text.substr(start, end == std::string::npos ? std::string::npos : end - start);
+
+        // "n" or "first-last"
+        char* parsed = nullptr;
+        long first = std::strtol(range.c_str(), &parsed, 10);
+        long last = first;
+        if (parsed == range.c_str()) {
+            return false;
+        }
+        if (*parsed == '-') {
+            const char* second = parsed + 1;
+            last = std::strtol(second, &parsed, 10);
+            if (parsed == second) {
+                return false;
+            }
+        }
+        if (*parsed != '\0' || first < 0 || last < first || last >= CPU_LIMIT) {
+            return false;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return !cpus.empty();
+}
+
+bool ServerConfig::apply_cpu_affinity() const {
+    if (cpu_affinity.empty()) {
+        return true;
+    }
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpu_affinity) {
+        CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        std::cerr << "Failed to set CPU affinity" << std::endl;
+        return false;
+    }
+    return true;
+#else
+    std::cerr << "CPU_AFFINITY is only supported on Linux" << std::endl;
+    return false;
+#endif
+}
+
+bool ServerConfig::pin_current_thread(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return false;
+    }
+#ifdef __linux__
+    static std::atomic<size_t> next_cpu{0};
+    int cpu = cpus[next_cpu.fetch_add(1, std::memory_order_relaxed) % cpus.size()];
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
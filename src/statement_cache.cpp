@@ -0,0 +1,58 @@
+#include "statement_cache.h"
+#include <iostream>
+
+Statement& Statement::operator=(Statement&& other) noexcept {
+    if (this != &other) {
+        release();
+        stmt = other.stmt;
+        owned = other.owned;
+        other.stmt = nullptr;
+    }
+    return *this;
+}
+
+void Statement::release() {
+    if (stmt) {
+        if (owned) {
+            sqlite3_finalize(stmt);
+        } else {
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+        }
+        stmt = nullptr;
+    }
+}
+
+Statement StatementCache::prepare(sqlite3* db, std::string_view sql) {
+    lookup_key.assign(sql.data(), sql.size());
+    auto it = statements.find(lookup_key);
+    // A busy statement is still being stepped by an outer caller on this connection
+    if (it != statements.end() && !sqlite3_stmt_busy(it->second)) {
+        ++hit_count;
+        return Statement(it->second, false);
+    }
+
+    ++miss_count;
+    sqlite3_stmt* stmt = nullptr;
+    int rc = sqlite3_prepare_v3(db, lookup_key.c_str(), static_cast<int>(lookup_key.size() + 1),
+                                SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << std::endl;
+        return Statement();
+    }
+
+    // Once full, hand out one-shot statements rather than evicting ones that may be in use
+    if (it != statements.end() || statements.size() >= capacity) {
+        return Statement(stmt, true);
+    }
+
+    statements.emplace(lookup_key, stmt);
+    return Statement(stmt, false);
+}
+
+void StatementCache::clear() {
+    for (auto& entry : statements) {
+        sqlite3_finalize(entry.second);
+    }
+    statements.clear();
+}
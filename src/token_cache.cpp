@@ -0,0 +1,148 @@
+#include "token_cache.h"
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+TokenCache::TokenCache(size_t capacity, long long token_lifetime_seconds, size_t shard_count)
+    : token_lifetime_seconds(token_lifetime_seconds) {
+    if (shard_count == 0) {
+        shard_count = 1;
+    }
+    capacity_per_shard = std::max<size_t>(1, capacity / shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+long long TokenCache::now_seconds() {
+    auto now = std::chrono::system_clock::now();
+    return std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+}
+
+TokenCache::Shard& TokenCache::shard_for(uint64_t hash) const {
+    return *shards[(hash >> 48) % shards.size()];
+}
+
+std::optional<std::pair<int, std::string>> TokenCache::verify(std::string_view token) {
+    uint64_t hash = std::hash<std::string_view>{}(token);
+    Shard& shard = shard_for(hash);
+    long long now = now_seconds();
+
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.entries.find(hash);
+        if (it != shard.entries.end() && it->second.token == token && it->second.expires_at >= now) {
+            it->second.referenced.store(true, std::memory_order_relaxed);
+            shard.hits.fetch_add(1, std::memory_order_relaxed);
+            return std::make_pair(it->second.user_id, it->second.username);
+        }
+    }
+
+    shard.misses.fetch_add(1, std::memory_order_relaxed);
+    auto claims = AuthService::decode_jwt_token(token);
+    if (!claims) {
+        return std::nullopt;
+    }
+
+    // Holding the revocation lock across the insert keeps revoke_user from slipping in between
+    std::shared_lock<std::shared_mutex> revocation_lock(revocation_mutex);
+    if (is_revoked_locked(*claims)) {
+        rejected_revoked.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.entries.find(hash);
+        if (it == shard.entries.end()) {
+            if (shard.entries.size() >= capacity_per_shard) {
+                evict_one_locked(shard, now);
+            }
+            it = shard.entries.try_emplace(hash).first;
+            it->second.ring_index = shard.ring.size();
+            shard.ring.push_back(hash);
+        }
+        Entry& entry = it->second;
+        entry.token.assign(token.data(), token.size());
+        entry.user_id = claims->user_id;
+        entry.username = claims->username;
+        entry.expires_at = claims->expires_at;
+        entry.referenced.store(true, std::memory_order_relaxed);
+    }
+
+    return std::make_pair(claims->user_id, std::move(claims->username));
+}
+
+void TokenCache::erase_locked(Shard& shard, std::unordered_map<uint64_t, Entry>::iterator it) {
+    size_t index = it->second.ring_index;
+    uint64_t moved_hash = shard.ring.back();
+    shard.ring[index] = moved_hash;
+    shard.ring.pop_back();
+    if (moved_hash != it->first) {
+        shard.entries.find(moved_hash)->second.ring_index = index;
+    }
+    shard.entries.erase(it);
+}
+
+void TokenCache::evict_one_locked(Shard& shard, long long now) {
+    while (!shard.ring.empty()) {
+        if (shard.hand >= shard.ring.size()) {
+            shard.hand = 0;
+        }
+
+        auto it = shard.entries.find(shard.ring[shard.hand]);
+        if (it->second.expires_at >= now && it->second.referenced.exchange(false, std::memory_order_relaxed)) {
+            ++shard.hand;
+            continue;
+        }
+
+        // The last ring entry moves into the hand's position, so the hand stays put
+        erase_locked(shard, it);
+        return;
+    }
+}
+
+bool TokenCache::is_revoked_locked(const AuthService::TokenClaims& claims) const {
+    auto it = revoked_at.find(claims.user_id);
+    return it != revoked_at.end() && claims.issued_at <= it->second;
+}
+
+void TokenCache::revoke_user(int user_id) {
+    long long now = now_seconds();
+
+    std::unique_lock<std::shared_mutex> revocation_lock(revocation_mutex);
+    revoked_at[user_id] = now;
+
+    // Revocations older than a token lifetime can no longer match a live token
+    for (auto it = revoked_at.begin(); it != revoked_at.end();) {
+        if (it->second + token_lifetime_seconds < now) {
+            it = revoked_at.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard->mutex);
+        for (auto it = shard->entries.begin(); it != shard->entries.end();) {
+            auto next = std::next(it);
+            if (it->second.user_id == user_id) {
+                erase_locked(*shard, it);
+            }
+            it = next;
+        }
+    }
+}
+
+TokenCache::Stats TokenCache::stats() const {
+    Stats stats;
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        stats.hits += shard->hits.load(std::memory_order_relaxed);
+        stats.misses += shard->misses.load(std::memory_order_relaxed);
+        stats.entries += shard->entries.size();
+    }
+    stats.rejected_revoked = rejected_revoked.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,186 @@
+#include "write_queue.h"
+#include "connection_pool.h"
+#include "metrics.h"
+#include <iostream>
+
+WriteQueue::WriteQueue(const std::string& db_path, size_t max_batch, std::chrono::microseconds max_delay)
+    : db_path(db_path), max_batch(max_batch == 0 ? 1 : max_batch), max_delay(max_delay) {}
+
+WriteQueue::~WriteQueue() {
+    stop();
+}
+
+bool WriteQueue::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) {
+        return true;
+    }
+    
+    db = ConnectionPool::open_connection(db_path);
+    if (!db) {
+        return false;
+    }
+    
+    running = true;
+    writer = std::thread([this]() { writer_loop(); });
+    return true;
+}
+
+void WriteQueue::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    ready.notify_all();
+    writer.join();
+    
+    statements.clear();
+    sqlite3_close(db);
+    db = nullptr;
+}
+
+std::future<bool> WriteQueue::submit(Operation op) {
+    Pending pending{std::move(op), std::promise<bool>()};
+    auto future = pending.done.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            pending.done.set_value(false);
+            return future;
+        }
+        queue.push_back(std::move(pending));
+    }
+    ready.notify_one();
+    return future;
+}
+
+bool WriteQueue::run(Operation op) {
+    // From the caller's point of view, waiting for the group commit is database time
+    Metrics::StageTimer timer(Metrics::Stage::Database);
+    return submit(std::move(op)).get();
+}
+
+void WriteQueue::writer_loop() {
+    std::vector<Pending> batch;
+    batch.reserve(max_batch);
+    
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]() { return !running || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            
+            if (max_delay.count() > 0 && queue.size() < max_batch) {
+                ready.wait_for(lock, max_delay, [this]() { return !running || queue.size() >= max_batch; });
+            }
+            
+            while (!queue.empty() && batch.size() < max_batch) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
+        
+        commit_batch(batch);
+        batch.clear();
+    }
+}
+
+bool WriteQueue::step(const char* sql) {
+    Statement stmt = statements.prepare(db, sql);
+    if (!stmt || sqlite3_step(stmt.get()) != SQLITE_DONE) {
+        std::cerr << "Write queue error on \"" << sql << "\": " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void WriteQueue::commit_batch(std::vector<Pending>& batch) {
+    std::vector<bool> results(batch.size(), false);
+    Context ctx(db, statements);
+    
+    bool committed = false;
+    bool aborted = false;
+    if (step("BEGIN IMMEDIATE;")) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            size_t first_action = ctx.actions.size();
+            if (!step("SAVEPOINT write_op;")) {
+                break;
+            }
+            
+            bool ok = false;
+            try {
+                ok = batch[i].op(ctx);
+            } catch (const std::exception& e) {
+                std::cerr << "Write operation failed: " << e.what() << std::endl;
+            } catch (...) {
+                // Anything escaping here would terminate the writer thread with every promise pending
+                std::cerr << "Write operation failed" << std::endl;
+            }
+            
+            if (!ok) {
+                step("ROLLBACK TO write_op;");
+                ctx.actions.resize(first_action);
+            }
+            bool released = step("RELEASE write_op;");
+            if (ok && !released) {
+                // The caller is told this write failed, so its changes must not be committed
+                step("ROLLBACK TO write_op;");
+                ctx.actions.resize(first_action);
+                released = step("RELEASE write_op;");
+            }
+            if (!released) {
+                // The savepoint can't be closed; nothing in this transaction can be trusted
+                aborted = true;
+                break;
+            }
+            results[i] = ok;
+        }
+        
+        committed = !aborted && step("COMMIT;");
+        if (!committed) {
+            step("ROLLBACK;");
+        }
+    }
+    
+    if (committed) {
+        // Cache invalidations and the like; one that throws must not take the writer
+        // thread down or strand the promises below
+        for (auto& action : ctx.actions) {
+            try {
+                action();
+            } catch (const std::exception& e) {
+                std::cerr << "Write queue after-commit action failed: " << e.what() << std::endl;
+            } catch (...) {
+                std::cerr << "Write queue after-commit action failed" << std::endl;
+            }
+        }
+    }
+    
+    size_t failures = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        bool ok = committed && results[i];
+        failures += ok ? 0 : 1;
+        batch[i].done.set_value(ok);
+    }
+    
+    batches.fetch_add(1, std::memory_order_relaxed);
+    operations.fetch_add(batch.size(), std::memory_order_relaxed);
+    failed.fetch_add(failures, std::memory_order_relaxed);
+    if (batch.size() > largest_batch.load(std::memory_order_relaxed)) {
+        largest_batch.store(batch.size(), std::memory_order_relaxed);
+    }
+}
+
+WriteQueue::Stats WriteQueue::stats() const {
+    Stats stats;
+    stats.batches = batches.load(std::memory_order_relaxed);
+    stats.operations = operations.load(std::memory_order_relaxed);
+    stats.failed = failed.load(std::memory_order_relaxed);
+    stats.largest_batch = largest_batch.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -104,5 +104,119 @@ curl -s -X POST $BASE_URL/tasks \
     "description": "This should fail"
   }' | jq '.'
 
+# The checks below compare status codes and fields instead of only printing responses
+FAILURES=0
+
+# expect <description> <expected> <actual>
+expect() {
+    if [ "$2" = "$3" ]; then
+        echo -e "${GREEN}✅ $1${NC}"
+    else
+        echo -e "${RED}❌ $1: expected $2, got $3${NC}"
+        FAILURES=$((FAILURES + 1))
+    fi
+}
+
+# A second user owns a task that testuser must not be able to change
+echo -e "\n${YELLOW}12. Setting up a second user...${NC}"
+curl -s -o /dev/null -X POST $BASE_URL/auth/register \
+  -H "Content-Type: application/json" \
+  -d '{"username": "otheruser", "email": "other@example.com", "password": "otherpass123"}'
+OTHER_TOKEN=$(curl -s -X POST $BASE_URL/auth/login \
+  -H "Content-Type: application/json" \
+  -d '{"username": "otheruser", "password": "otherpass123"}' | jq -r '.data.token // empty')
+OTHER_TASK=$(curl -s -X POST $BASE_URL/tasks/batch \
+  -H "Content-Type: application/json" \
+  -H "Authorization: Bearer $OTHER_TOKEN" \
+  -d '{"tasks": [{"title": "Other user task"}]}' | jq -r '.data.results[0].id // empty')
+expect "second user's task created" "true" "$([ -n "$OTHER_TASK" ] && echo true || echo false)"
+
+# Batch create: the item without a title fails on its own, the rest are created
+echo -e "\n${YELLOW}13. Testing batch create with a partial failure...${NC}"
+BATCH_RESPONSE=$(curl -s -w '\n%{http_code}' -X POST $BASE_URL/tasks/batch \
+  -H "Content-Type: application/json" \
+  -H "Authorization: Bearer $TOKEN" \
+  -d '{"tasks": [{"title": "Batch one"}, {"description": "No title"}, {"title": "Batch three", "description": "Third"}]}')
+BATCH_BODY=$(echo "$BATCH_RESPONSE" | sed '$d')
+echo "$BATCH_BODY" | jq '.'
+expect "batch create status" "200" "$(echo "$BATCH_RESPONSE" | tail -n1)"
+expect "batch create item statuses" "201,400,201" "$(echo "$BATCH_BODY" | jq -r '[.data.results[].status] | join(",")')"
+expect "batch create counts" "2/1" "$(echo "$BATCH_BODY" | jq -r '"\(.data.succeeded)/\(.data.failed)"')"
+BATCH_FIRST=$(echo "$BATCH_BODY" | jq -r '.data.results[0].id')
+BATCH_THIRD=$(echo "$BATCH_BODY" | jq -r '.data.results[2].id')
+
+# Batch update: own task, another user's task, a missing task and an item without an id
+echo -e "\n${YELLOW}14. Testing batch update with partial failures...${NC}"
+BATCH_BODY=$(curl -s -X PUT $BASE_URL/tasks/batch \
+  -H "Content-Type: application/json" \
+  -H "Authorization: Bearer $TOKEN" \
+  -d "{\"tasks\": [{\"id\": $BATCH_FIRST, \"completed\": true}, {\"id\": $OTHER_TASK, \"title\": \"Hijacked\"}, {\"id\": 999999, \"title\": \"Missing\"}, {\"title\": \"No id\"}]}")
+echo "$BATCH_BODY" | jq '.'
+expect "batch update item statuses" "200,403,404,400" "$(echo "$BATCH_BODY" | jq -r '[.data.results[].status] | join(",")')"
+expect "batch update kept other fields" "Batch one true" \
+  "$(curl -s $BASE_URL/tasks/$BATCH_FIRST | jq -r '"\(.data.title) \(.data.completed)"')"
+
+# Batch delete: own task, another user's task, a missing task and a non-integer id
+echo -e "\n${YELLOW}15. Testing batch delete with partial failures...${NC}"
+BATCH_BODY=$(curl -s -X DELETE $BASE_URL/tasks/batch \
+  -H "Content-Type: application/json" \
+  -H "Authorization: Bearer $TOKEN" \
+  -d "{\"ids\": [$BATCH_THIRD, $OTHER_TASK, 999999, \"x\"]}")
+echo "$BATCH_BODY" | jq '.'
+expect "batch delete item statuses" "200,403,404,400" "$(echo "$BATCH_BODY" | jq -r '[.data.results[].status] | join(",")')"
+expect "batch-deleted task is gone" "404" "$(curl -s -o /dev/null -w '%{http_code}' $BASE_URL/tasks/$BATCH_THIRD)"
+expect "other user's task survives" "200" "$(curl -s -o /dev/null -w '%{http_code}' $BASE_URL/tasks/$OTHER_TASK)"
+expect "batch without authentication" "401" "$(curl -s -o /dev/null -w '%{http_code}' -X DELETE $BASE_URL/tasks/batch \
+  -H "Content-Type: application/json" -d '{"ids": [1]}')"
+
+# PATCH changes only the fields in the body
+echo -e "\n${YELLOW}16. Testing PATCH and partial PUT...${NC}"
+expect "patch status" "200" "$(curl -s -o /dev/null -w '%{http_code}' -X PATCH $BASE_URL/tasks/$BATCH_FIRST \
+  -H "Content-Type: application/json" \
+  -H "Authorization: Bearer $TOKEN" \
+  -d '{"description": "Patched"}')"
+expect "patch kept the title" "Batch one Patched" \
+  "$(curl -s $BASE_URL/tasks/$BATCH_FIRST | jq -r '"\(.data.title) \(.data.description)"')"
+
+# PUT keeps accepting partial bodies, as it always has
+expect "partial put status" "200" "$(curl -s -o /dev/null -w '%{http_code}' -X PUT $BASE_URL/tasks/$BATCH_FIRST \
+  -H "Content-Type: application/json" \
+  -H "Authorization: Bearer $TOKEN" \
+  -d '{"completed": true}')"
+expect "partial put kept the description" "Patched true" \
+  "$(curl -s $BASE_URL/tasks/$BATCH_FIRST | jq -r '"\(.data.description) \(.data.completed)"')"
+
+# Full-text search
+echo -e "\n${YELLOW}17. Testing search...${NC}"
+SEARCH_BODY=$(curl -s "$BASE_URL/tasks/search?q=batch")
+echo "$SEARCH_BODY" | jq '.'
+expect "search finds the batch task" "true" "$(echo "$SEARCH_BODY" | jq --argjson id "$BATCH_FIRST" '[.data[].id] | index($id) != null')"
+expect "search without q" "400" "$(curl -s -o /dev/null -w '%{http_code}' $BASE_URL/tasks/search)"
+
+# Change feed
+echo -e "\n${YELLOW}18. Testing the change feed...${NC}"
+CHANGES_BODY=$(curl -s "$BASE_URL/tasks/changes?since=0")
+echo "$CHANGES_BODY" | jq '.pagination'
+expect "changes include a tombstone" "true" \
+  "$(echo "$CHANGES_BODY" | jq --argjson id "$BATCH_THIRD" '[.data[] | select(.id == $id and .deleted)] | length == 1')"
+CURSOR=$(echo "$CHANGES_BODY" | jq -r '.pagination.next_cursor')
+expect "changes after the last cursor" "0" "$(curl -s "$BASE_URL/tasks/changes?since=$CURSOR" | jq '.data | length')"
+expect "changes with an invalid cursor" "400" "$(curl -s -o /dev/null -w '%{http_code}' "$BASE_URL/tasks/changes?since=abc")"
+
+# Conditional GET
+echo -e "\n${YELLOW}19. Testing ETag / If-None-Match...${NC}"
+ETAG=$(curl -s -D - -o /dev/null $BASE_URL/tasks/$BATCH_FIRST | tr -d '\r' | awk 'tolower($1) == "etag:" {print $2}')
+echo "ETag: $ETAG"
+expect "matching If-None-Match" "304" "$(curl -s -o /dev/null -w '%{http_code}' -H "If-None-Match: $ETAG" $BASE_URL/tasks/$BATCH_FIRST)"
+curl -s -o /dev/null -X PATCH $BASE_URL/tasks/$BATCH_FIRST \
+  -H "Content-Type: application/json" \
+  -H "Authorization: Bearer $TOKEN" \
+  -d '{"completed": false}'
+expect "If-None-Match after a write" "200" "$(curl -s -o /dev/null -w '%{http_code}' -H "If-None-Match: $ETAG" $BASE_URL/tasks/$BATCH_FIRST)"
+
 echo -e "\n${GREEN}🎉 API testing completed!${NC}"
+if [ $FAILURES -gt 0 ]; then
+    echo -e "${RED}❌ $FAILURES check(s) failed${NC}"
+    exit 1
+fi
 echo -e "${BLUE}Check the responses above for any errors.${NC}"